@@ -0,0 +1,404 @@
+// Multi-core contention benchmarks for shared ownership.
+//
+// Every workload is run on pinned threads for a sweep of thread counts and
+// reports throughput, p50/p99 latency per operation and, where
+// perf_event_open is permitted, the hardware cache misses of the workers.
+//
+//   g++ -std=c++14 -O2 -pthread bench_for_contention.cpp -o bench_for_contention
+//   ./bench_for_contention [max_threads] [ops_per_thread]
+#include "shared_ptr.h"
+#include "unique_ptr.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace bench
+{
+    using clock_type = std::chrono::steady_clock;
+
+    // Operations timed together; the per-operation latency is the batch time divided by this.
+    constexpr std::size_t batch_size = 64;
+
+    /// Pin the calling thread to a cpu, round-robin over the online cpus
+    inline void pin_to_cpu(unsigned idx)
+    {
+#ifdef __linux__
+        unsigned ncpu = std::max(1u, std::thread::hardware_concurrency());
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(idx % ncpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+        (void)idx;
+#endif
+    }
+
+    // Hardware cache-miss counter of the calling thread.
+    // valid() is false when perf_event_open is not available or not permitted.
+    class cache_miss_counter
+    {
+    private:
+        int _M_fd = -1;
+
+    public:
+        cache_miss_counter()
+        {
+#ifdef __linux__
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.type           = PERF_TYPE_HARDWARE;
+            attr.size           = sizeof(attr);
+            attr.config         = PERF_COUNT_HW_CACHE_MISSES;
+            attr.disabled       = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv     = 1;
+            _M_fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+        }
+
+        ~cache_miss_counter()
+        {
+#ifdef __linux__
+            if (_M_fd >= 0)
+                close(_M_fd);
+#endif
+        }
+
+        bool valid() const noexcept
+        {
+            return _M_fd >= 0;
+        }
+
+        void start() noexcept
+        {
+#ifdef __linux__
+            if (valid())
+            {
+                ioctl(_M_fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(_M_fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+#endif
+        }
+
+        long long stop() noexcept
+        {
+            long long count = 0;
+#ifdef __linux__
+            if (valid())
+            {
+                ioctl(_M_fd, PERF_EVENT_IOC_DISABLE, 0);
+                if (read(_M_fd, &count, sizeof(count)) != sizeof(count))
+                    count = 0;
+            }
+#endif
+            return count;
+        }
+
+        cache_miss_counter(const cache_miss_counter&) = delete;
+        cache_miss_counter& operator=(const cache_miss_counter&) = delete;
+    };
+
+    struct result
+    {
+        unsigned  threads      = 0;    // threads actually run
+        double    ops_per_sec  = 0;
+        double    p50_ns       = 0;
+        double    p99_ns       = 0;
+        long long cache_misses = 0;
+        bool      has_misses   = true;
+    };
+
+    // State handed to every worker thread
+    struct worker
+    {
+        unsigned            id;
+        std::size_t         ops = 0;
+        std::vector<double> samples;    // latency samples in ns
+        long long           misses = 0;
+        bool                has_misses = false;
+    };
+
+    /// Keep the optimizer from discarding a value
+    template<typename T>
+    inline void do_not_optimize(const T& value)
+    {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    inline double percentile(std::vector<double>& v, double p)
+    {
+        if (v.empty())
+            return 0;
+        std::size_t idx = static_cast<std::size_t>(p * (v.size() - 1));
+        std::nth_element(v.begin(), v.begin() + idx, v.end());
+        return v[idx];
+    }
+
+    /*
+    * Run body(worker&) on @p threads pinned threads which are released together,
+    * and fold their operation counts, latency samples and cache misses into a result.
+    */
+    template<typename Body>
+    result run(unsigned threads, Body body)
+    {
+        std::vector<std::unique_ptr<worker>> workers;
+        for (unsigned i = 0; i < threads; ++i)
+        {
+            workers.emplace_back(new worker);
+            workers.back()->id = i;
+        }
+
+        std::atomic<unsigned> ready(0);
+        std::atomic<bool>     go(false);
+        std::vector<std::thread> pool;
+        for (unsigned i = 0; i < threads; ++i)
+        {
+            pool.emplace_back([&, i] {
+                worker& w = *workers[i];
+                pin_to_cpu(i);
+                // The counter follows the thread opening it, so open it here and not in run()
+                cache_miss_counter counter;
+                ready.fetch_add(1);
+                while (!go.load(std::memory_order_acquire))
+                    std::this_thread::yield();
+                counter.start();
+                body(w);
+                w.misses = counter.stop();
+                w.has_misses = counter.valid();
+            });
+        }
+
+        while (ready.load() != threads)
+            std::this_thread::yield();
+        auto begin = clock_type::now();
+        go.store(true, std::memory_order_release);
+        for (auto& t : pool)
+            t.join();
+        auto elapsed = std::chrono::duration<double>(clock_type::now() - begin).count();
+
+        result r;
+        r.threads = threads;
+        std::vector<double> samples;
+        std::size_t ops = 0;
+        for (auto& w : workers)
+        {
+            ops += w->ops;
+            samples.insert(samples.end(), w->samples.begin(), w->samples.end());
+            if (w->has_misses)
+                r.cache_misses += w->misses;
+            else
+                r.has_misses = false;
+        }
+        r.ops_per_sec = ops / elapsed;
+        r.p50_ns = percentile(samples, 0.50);
+        r.p99_ns = percentile(samples, 0.99);
+        return r;
+    }
+
+    /// Time @p ops calls of op() in batches and record the per-operation latency
+    template<typename Op>
+    inline void timed_loop(worker& w, std::size_t ops, Op op)
+    {
+        w.samples.reserve(ops / batch_size + 1);
+        for (std::size_t done = 0; done < ops; done += batch_size)
+        {
+            auto t0 = clock_type::now();
+            for (std::size_t i = 0; i < batch_size; ++i)
+                op();
+            auto t1 = clock_type::now();
+            w.samples.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count() / batch_size);
+            w.ops += batch_size;
+        }
+    }
+
+    inline void report(const char* name, const result& r)
+    {
+        std::printf("%-24s %3u threads  %12.0f ops/s  p50 %8.1f ns  p99 %8.1f ns  ",
+                    name, r.threads, r.ops_per_sec, r.p50_ns, r.p99_ns);
+        if (r.has_misses)
+            std::printf("cache-misses %lld\n", r.cache_misses);
+        else
+            std::printf("cache-misses n/a\n");
+    }
+
+    // Shared-ownership families under test
+    struct std_family
+    {
+        template<typename T> using shared = std::shared_ptr<T>;
+        template<typename T> using weak   = std::weak_ptr<T>;
+
+        static constexpr const char* name = "std";
+
+        template<typename T, typename ... Args>
+        static shared<T> make(Args&& ... args)
+        {
+            return std::make_shared<T>(std::forward<Args>(args)...);
+        }
+    };
+
+    struct sm_family
+    {
+        template<typename T> using shared = sm_ptr::shared_ptr<T>;
+        template<typename T> using weak   = sm_ptr::weak_ptr<T>;
+
+        static constexpr const char* name = "sm_ptr";
+
+        template<typename T, typename ... Args>
+        static shared<T> make(Args&& ... args)
+        {
+            return sm_ptr::make_shared<T>(std::forward<Args>(args)...);
+        }
+    };
+
+    // All threads copy and destroy a shared_ptr to the same object
+    template<typename Family>
+    result shared_copy(unsigned threads, std::size_t ops)
+    {
+        auto obj = Family::template make<long>(42);
+        return run(threads, [&](worker& w) {
+            timed_loop(w, ops, [&] {
+                typename Family::template shared<long> copy(obj);
+                do_not_optimize(copy);
+            });
+        });
+    }
+
+    // All threads lock a weak_ptr to the same live object
+    template<typename Family>
+    result weak_lock(unsigned threads, std::size_t ops)
+    {
+        auto obj = Family::template make<long>(42);
+        typename Family::template weak<long> observer(obj);
+        return run(threads, [&](worker& w) {
+            timed_loop(w, ops, [&] {
+                auto locked = observer.lock();
+                do_not_optimize(locked);
+            });
+        });
+    }
+
+    struct message
+    {
+        clock_type::time_point sent;
+        char                   payload[112];
+    };
+
+    // Bounded mutex protected queue handing unique_ptr ownership from producers to consumers
+    class handoff_queue
+    {
+    private:
+        static constexpr std::size_t capacity = 1024;
+
+        std::mutex                                   _M_mutex;
+        std::condition_variable                      _M_not_empty;
+        std::condition_variable                      _M_not_full;
+        std::deque<sm_ptr::unique_ptr<message>>      _M_items;
+
+    public:
+        void push(sm_ptr::unique_ptr<message> m)
+        {
+            {
+                std::unique_lock<std::mutex> lock(_M_mutex);
+                _M_not_full.wait(lock, [this] { return _M_items.size() < capacity; });
+                _M_items.push_back(std::move(m));
+            }
+            _M_not_empty.notify_one();
+        }
+
+        sm_ptr::unique_ptr<message> pop()
+        {
+            sm_ptr::unique_ptr<message> m;
+            {
+                std::unique_lock<std::mutex> lock(_M_mutex);
+                _M_not_empty.wait(lock, [this] { return !_M_items.empty(); });
+                m = std::move(_M_items.front());
+                _M_items.pop_front();
+            }
+            _M_not_full.notify_one();
+            return m;
+        }
+    };
+
+    // Even threads produce unique_ptr<message>, odd threads consume them.
+    // An odd thread count is rounded down, the result reports the threads run.
+    // Latency is measured from push to pop.
+    inline result unique_handoff(unsigned threads, std::size_t ops)
+    {
+        threads = std::max(2u, threads - threads % 2);
+        std::vector<std::unique_ptr<handoff_queue>> queues;
+        for (unsigned i = 0; i < threads / 2; ++i)
+            queues.emplace_back(new handoff_queue);
+
+        return run(threads, [&](worker& w) {
+            handoff_queue& q = *queues[w.id / 2];
+            if (w.id % 2 == 0)
+            {
+                for (std::size_t i = 0; i < ops; ++i)
+                {
+                    auto m = sm_ptr::make_unique<message>();
+                    m->sent = clock_type::now();
+                    q.push(std::move(m));
+                }
+                return;
+            }
+            w.samples.reserve(ops);
+            for (std::size_t i = 0; i < ops; ++i)
+            {
+                auto m = q.pop();
+                w.samples.push_back(std::chrono::duration<double, std::nano>(clock_type::now() - m->sent).count());
+                ++w.ops;
+            }
+        });
+    }
+
+    template<typename Family>
+    void sweep_shared(const std::vector<unsigned>& counts, std::size_t ops)
+    {
+        for (unsigned n : counts)
+            report((std::string(Family::name) + " shared copy").c_str(), shared_copy<Family>(n, ops));
+        for (unsigned n : counts)
+            report((std::string(Family::name) + " weak lock").c_str(), weak_lock<Family>(n, ops));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    unsigned max_threads = argc > 1 ? std::atoi(argv[1])
+                                    : std::max(2u, std::thread::hardware_concurrency());
+    std::size_t ops = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000000;
+
+    std::vector<unsigned> counts;
+    for (unsigned n = 1; n < max_threads; n *= 2)
+        counts.push_back(n);
+    counts.push_back(max_threads);
+
+    if (!bench::cache_miss_counter().valid())
+        std::printf("perf_event_open unavailable, cache misses are not reported\n");
+
+    // std::shared_ptr provides the reference numbers
+    bench::sweep_shared<bench::std_family>(counts, ops);
+    bench::sweep_shared<bench::sm_family>(counts, ops);
+
+    for (unsigned n : counts)
+        if (n >= 2)
+            bench::report("unique_ptr handoff", bench::unique_handoff(n, ops / 4));
+}
@@ -0,0 +1,85 @@
+// Read-heavy pipeline passing a feature vector through stages,
+// either as a value copied into every stage or as a cow_ptr.
+//
+//   g++ -std=c++14 -O2 bench_for_cow_ptr.cpp -o bench_for_cow_ptr
+//   ./bench_for_cow_ptr [items]
+#include "cow_ptr.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace bench
+{
+    using clock_type = std::chrono::steady_clock;
+    using features   = std::vector<float>;
+
+    constexpr std::size_t feature_count = 1024;
+    constexpr unsigned    stage_count   = 8;
+
+    float sink = 0;
+
+    // Read a strided sample of the features, as a scoring stage would
+    inline float read(const features& f)
+    {
+        float sum = 0;
+        for (std::size_t i = 0; i < f.size(); i += 16)
+            sum += f[i];
+        return sum;
+    }
+
+    // Every stage reads the features and, once every @p write_every items, rescales them.
+    // A write_every of zero never writes.
+
+    __attribute__((noinline))
+    void value_stage(features f, unsigned stage, std::size_t item, std::size_t write_every)
+    {
+        if (write_every != 0 && stage == 0 && item % write_every == 0)
+            for (auto& x : f)
+                x *= 0.5f;
+        sink += read(f);
+        if (stage + 1 < stage_count)
+            value_stage(f, stage + 1, item, write_every);
+    }
+
+    __attribute__((noinline))
+    void cow_stage(sm_ptr::cow_ptr<features> f, unsigned stage, std::size_t item, std::size_t write_every)
+    {
+        if (write_every != 0 && stage == 0 && item % write_every == 0)
+            for (auto& x : *f.get_mutable())
+                x *= 0.5f;
+        sink += read(*f);
+        if (stage + 1 < stage_count)
+            cow_stage(f, stage + 1, item, write_every);
+    }
+
+    template<typename Run>
+    double ns_per_item(std::size_t items, Run run)
+    {
+        auto t0 = clock_type::now();
+        for (std::size_t i = 0; i < items; ++i)
+            run(i);
+        auto t1 = clock_type::now();
+        return std::chrono::duration<double, std::nano>(t1 - t0).count() / items;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t items = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+
+    bench::features source(bench::feature_count, 1.0f);
+    auto shared = sm_ptr::make_cow<bench::features>(source);
+
+    for (std::size_t write_every : {0, 100, 10})
+    {
+        double value = bench::ns_per_item(items, [&](std::size_t i) {
+            bench::value_stage(source, 0, i, write_every);
+        });
+        double cow = bench::ns_per_item(items, [&](std::size_t i) {
+            bench::cow_stage(shared, 0, i, write_every);
+        });
+        std::printf("writes every %3zu items   value copies %9.1f ns/item   cow_ptr %9.1f ns/item\n",
+                    write_every, value, cow);
+    }
+}
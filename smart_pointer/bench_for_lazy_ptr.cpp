@@ -0,0 +1,113 @@
+// Startup of a service owning many expensive subsystems, held eagerly by unique_ptr
+// members against lazily by lazy_ptr members, when only a fraction is ever used.
+// Also measures access to a subsystem once it exists.
+//
+//   g++ -std=c++14 -O2 -pthread bench_for_lazy_ptr.cpp -o bench_for_lazy_ptr
+//   ./bench_for_lazy_ptr [subsystems] [rounds]
+#include "lazy_ptr.h"
+#include "unique_ptr.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <vector>
+
+namespace bench
+{
+    using clock_type = std::chrono::steady_clock;
+
+    // A subsystem building a table when constructed, like a cache or a parser would
+    struct subsystem
+    {
+        std::vector<int> table;
+
+        subsystem()
+            : table(16384)
+        {
+            std::iota(table.begin(), table.end(), 0);
+        }
+
+        long query(std::size_t i) const
+        {
+            return table[i % table.size()];
+        }
+    };
+
+    struct eager_service
+    {
+        std::vector<sm_ptr::unique_ptr<subsystem>> parts;
+
+        explicit eager_service(std::size_t n)
+        {
+            for (std::size_t i = 0; i < n; ++i)
+                parts.push_back(sm_ptr::make_unique<subsystem>());
+        }
+
+        subsystem& part(std::size_t i) { return *parts[i]; }
+    };
+
+    struct lazy_service
+    {
+        std::vector<sm_ptr::lazy_ptr<subsystem>> parts;
+
+        explicit lazy_service(std::size_t n)
+            : parts(n) { }
+
+        subsystem& part(std::size_t i) { return *parts[i]; }
+    };
+
+    // Start the service and serve one request through every used-th subsystem
+    template<typename Service>
+    double startup_us(std::size_t n, std::size_t used, std::size_t rounds)
+    {
+        long sum = 0;
+        auto t0 = clock_type::now();
+        for (std::size_t r = 0; r < rounds; ++r)
+        {
+            Service service(n);
+            for (std::size_t i = 0; i < n; i += used)
+                sum += service.part(i).query(r);
+        }
+        auto t1 = clock_type::now();
+        if (sum == -1)
+            std::printf("unreachable\n");
+        return std::chrono::duration<double, std::micro>(t1 - t0).count() / rounds;
+    }
+
+    // Serve many requests from a started service
+    template<typename Service>
+    double access_ns(std::size_t n, std::size_t requests)
+    {
+        Service service(n);
+        for (std::size_t i = 0; i < n; ++i)
+            service.part(i);
+
+        long sum = 0;
+        auto t0 = clock_type::now();
+        for (std::size_t r = 0; r < requests; ++r)
+            sum += service.part(r % n).query(r);
+        auto t1 = clock_type::now();
+        if (sum == -1)
+            std::printf("unreachable\n");
+        return std::chrono::duration<double, std::nano>(t1 - t0).count() / requests;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 256;
+    std::size_t rounds = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 50;
+
+    std::printf("startup of %zu subsystems, one request through the used ones\n", n);
+    for (std::size_t used : {1, 4, 16, 64})
+    {
+        double eager = bench::startup_us<bench::eager_service>(n, used, rounds);
+        double lazy = bench::startup_us<bench::lazy_service>(n, used, rounds);
+        std::printf("1 in %2zu used   unique_ptr %9.1f us   lazy_ptr %9.1f us\n", used, eager, lazy);
+    }
+
+    std::size_t requests = 20000000;
+    std::printf("access once constructed   unique_ptr %5.2f ns   lazy_ptr %5.2f ns\n",
+                bench::access_ns<bench::eager_service>(n, requests),
+                bench::access_ns<bench::lazy_service>(n, requests));
+}
@@ -0,0 +1,90 @@
+// Churn of heavyweight message objects, allocated and destroyed every time
+// or recycled through object_pool.
+//
+//   g++ -std=c++14 -O2 -pthread bench_for_object_pool.cpp -o bench_for_object_pool
+//   ./bench_for_object_pool [threads] [iterations]
+#include "object_pool.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace bench
+{
+    using clock_type = std::chrono::steady_clock;
+
+    // A parsed message whose buffers grow to the same size on every use
+    struct message
+    {
+        std::string              header;
+        std::vector<int>         fields;
+        std::vector<std::string> tags;
+
+        void clear()
+        {
+            header.clear();
+            fields.clear();
+            for (auto& tag : tags)
+                tag.clear();
+        }
+    };
+
+    inline void parse(message& m, std::size_t i)
+    {
+        m.header.assign(200, char('a' + i % 26));
+        for (int f = 0; f < 64; ++f)
+            m.fields.push_back(f);
+        m.tags.resize(4);
+        for (auto& tag : m.tags)
+            tag.assign(40, 't');
+    }
+
+    // Keep a few messages in flight so the allocator can not simply reuse the last block
+    constexpr std::size_t in_flight = 8;
+
+    template<typename Acquire>
+    double ns_per_message(unsigned threads, std::size_t iterations, Acquire acquire)
+    {
+        auto t0 = clock_type::now();
+        std::vector<std::thread> pool;
+        for (unsigned t = 0; t < threads; ++t)
+            pool.emplace_back([&] {
+                std::vector<decltype(acquire())> live(in_flight);
+                for (std::size_t i = 0; i < iterations; ++i)
+                {
+                    auto m = acquire();
+                    parse(*m, i);
+                    live[i % in_flight] = std::move(m);
+                }
+            });
+        for (auto& t : pool)
+            t.join();
+        auto t1 = clock_type::now();
+        return std::chrono::duration<double, std::nano>(t1 - t0).count() / (iterations * threads);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    unsigned threads = argc > 1 ? std::atoi(argv[1]) : 1;
+    std::size_t iterations = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000000;
+
+    double plain = bench::ns_per_message(threads, iterations, [] {
+        return sm_ptr::make_unique<bench::message>();
+    });
+
+    sm_ptr::object_pool<bench::message> pool;
+    double pooled = bench::ns_per_message(threads, iterations, [&pool] {
+        return pool.acquire();
+    });
+
+    double pooled_shared = bench::ns_per_message(threads, iterations, [&pool] {
+        return pool.acquire_shared();
+    });
+
+    std::printf("%u threads   make_unique %8.1f ns/msg   object_pool %8.1f ns/msg   "
+                "object_pool shared %8.1f ns/msg\n",
+                threads, plain, pooled, pooled_shared);
+}
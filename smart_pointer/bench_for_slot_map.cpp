@@ -0,0 +1,89 @@
+// Observing entities through slot_map handles against weak_ptr::lock(),
+// with a fraction of the entities destroyed so some observations fail.
+//
+//   g++ -std=c++14 -O2 bench_for_slot_map.cpp -o bench_for_slot_map
+//   ./bench_for_slot_map [entities] [rounds]
+#include "shared_ptr.h"
+#include "slot_map.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace bench
+{
+    using clock_type = std::chrono::steady_clock;
+
+    struct entity
+    {
+        float x, y, z;
+        int   hp;
+    };
+
+    template<typename Run>
+    double ns_per_lookup(std::size_t lookups, std::size_t rounds, Run run)
+    {
+        auto t0 = clock_type::now();
+        long sum = 0;
+        for (std::size_t r = 0; r < rounds; ++r)
+            sum += run();
+        auto t1 = clock_type::now();
+        if (sum == -1)
+            std::printf("unreachable\n");
+        return std::chrono::duration<double, std::nano>(t1 - t0).count() / (lookups * rounds);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t entities = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    std::size_t rounds = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 50;
+
+    std::mt19937 rng(42);
+
+    // Entities created in a random order, as a game or simulation would
+    sm_ptr::slot_map<bench::entity> map;
+    std::vector<sm_ptr::slot_map<bench::entity>::handle> handles;
+    std::vector<sm_ptr::shared_ptr<bench::entity>> owners;
+    std::vector<sm_ptr::weak_ptr<bench::entity>> observers;
+    for (std::size_t i = 0; i < entities; ++i)
+    {
+        bench::entity e{float(i), 0, 0, int(i % 100)};
+        handles.push_back(map.insert(e));
+        owners.push_back(sm_ptr::make_shared<bench::entity>(e));
+        observers.emplace_back(owners.back());
+    }
+
+    // Destroy every tenth entity
+    for (std::size_t i = 0; i < entities; i += 10)
+    {
+        map.erase(handles[i]);
+        owners[i].reset();
+    }
+
+    std::vector<std::size_t> order(entities);
+    for (std::size_t i = 0; i < entities; ++i)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), rng);
+
+    double slot = bench::ns_per_lookup(entities, rounds, [&] {
+        long sum = 0;
+        for (std::size_t i : order)
+            if (auto e = map.get(handles[i]))
+                sum += e->hp;
+        return sum;
+    });
+
+    double weak = bench::ns_per_lookup(entities, rounds, [&] {
+        long sum = 0;
+        for (std::size_t i : order)
+            if (auto e = observers[i].lock())
+                sum += e->hp;
+        return sum;
+    });
+
+    std::printf("%zu entities   slot_map::get %6.2f ns/lookup   weak_ptr::lock %6.2f ns/lookup\n",
+                entities, slot, weak);
+}
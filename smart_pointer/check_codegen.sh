@@ -0,0 +1,115 @@
+#!/bin/sh
+# Compile the codegen_for_*.cpp files to assembly and check the rules
+# given by the names of their functions, see the comment at the top of each file.
+# Usage: ./check_codegen.sh [files...], CXX and CXXFLAGS are honoured.
+# Identical code folding is turned off so that every function keeps its own body.
+
+CXX=${CXX:-g++}
+CXXFLAGS=${CXXFLAGS:-"-std=c++14 -O2"}
+cd "$(dirname "$0")" || exit 1
+[ $# -gt 0 ] || set -- codegen_for_*.cpp
+
+# Print the instructions of function $1, including its cold part, from assembly file $2
+body()
+{
+    awk -v f="$1" '
+        $0 ~ "^" f "(\\.cold)?:" { on = 1; next }
+        on && $1 == ".size" { on = 0 }
+        on && $0 ~ /^\t[a-z]/ && $1 !~ /^\./ { print }
+    ' "$2"
+}
+
+# Print the loads, stores, branches, calls and instructions of AT&T instructions on stdin.
+# Tail calls count as calls, pushes and pops of the frame are left out of loads and stores.
+count()
+{
+    awk '
+        {
+            m = $1
+            rest = $0
+            sub(/^[ \t]*[^ \t]+[ \t]*/, "", rest)
+            n = 0; depth = 0; cur = ""
+            for (i = 1; i <= length(rest); i++)
+            {
+                c = substr(rest, i, 1)
+                if (c == "(") depth++
+                if (c == ")") depth--
+                if (c == "," && depth == 0) { ops[++n] = cur; cur = "" }
+                else cur = cur c
+            }
+            if (cur != "") ops[++n] = cur
+
+            instrs++
+            if (m ~ /^call/ || (m ~ /^jmp/ && rest !~ /^\.L/)) { calls++; next }
+            if (m ~ /^j/) { branches++; next }
+            if (m ~ /^(lea|nop|push|pop|ret|endbr)/) next
+            for (k = 1; k <= n; k++)
+            {
+                if (ops[k] !~ /\(/)
+                    continue
+                if (k < n || m ~ /^(cmp|test|bt)/ || (n == 1 && m ~ /^(i?mul|i?div)/))
+                    loads++
+                else if (m ~ /^(mov|set|stos)/)
+                    stores++
+                else
+                {
+                    loads++
+                    stores++
+                }
+            }
+        }
+        END { printf "%d %d %d %d %d\n", loads, stores, branches, calls, instrs }
+    '
+}
+
+status=0
+for src in "$@"; do
+    asm=$(mktemp)
+    if ! $CXX $CXXFLAGS -fno-ipa-icf -S -o "$asm" "$src"; then
+        echo "FAIL $src: does not compile"
+        status=1
+        continue
+    fi
+
+    for f in $(sed -n 's/^\(\(no\|sm\)_[a-z_0-9]*\):$/\1/p' "$asm"); do
+        code=$(body "$f" "$asm")
+        bad=""
+        case $f in
+            no_dispose_*)
+                bad=$(printf '%s\n' "$code" | grep -E 'call[a-z]*[[:space:]]+\*|jmp[a-z]*[[:space:]]+\*|_S_manage')
+                ;;
+            no_indirect_call_*)
+                bad=$(printf '%s\n' "$code" | grep -E 'call[a-z]*[[:space:]]+\*|jmp[a-z]*[[:space:]]+\*')
+                ;;
+            no_atomic_*)
+                bad=$(printf '%s\n' "$code" | grep -E '^[[:space:]]*(lock|xchg)')
+                ;;
+            sm_*)
+                # No more loads, stores, branches or calls than the raw pointer version
+                raw="raw_${f#sm_}"
+                if ! grep -q "^$raw:" "$asm"; then
+                    bad="no $raw to compare with"
+                else
+                    set -- $(printf '%s\n' "$code" | count) $(body "$raw" "$asm" | count)
+                    for kind in loads stores branches calls; do
+                        if [ "$1" -gt "$6" ]; then
+                            bad="$bad$kind $1 > $6 "
+                        fi
+                        shift
+                    done
+                    info="(instructions $1 against $6)"
+                fi
+                ;;
+        esac
+        if [ -n "$bad" ]; then
+            echo "FAIL $src: $f"
+            printf '%s\n' "$bad"
+            status=1
+        else
+            echo "ok   $src: $f ${info:-}"
+        fi
+        info=""
+    done
+    rm -f "$asm"
+done
+exit $status
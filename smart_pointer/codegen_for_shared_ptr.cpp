@@ -0,0 +1,49 @@
+#include "shared_ptr.h"
+
+// It is codegen checks for the shared_ptr control blocks, built by check_codegen.sh.
+// Each function creates an object and drops the last reference to it, so the
+// compiler sees the block type on the release path:
+//   no_indirect_call_*  must not contain any indirect call or jump
+//   no_dispose_*        must not call a manager either, nothing is disposed
+
+int destroyed = 0;
+
+struct Counted {
+    Counted(int _val) : val(_val) { }
+    ~Counted() { ++destroyed; }
+    int val;
+};
+
+struct Pod {
+    int x, y;
+};
+
+struct CountingDelete {
+    void operator()(int* p) const { ++destroyed; delete p; }
+};
+
+// Trivially destructible objects of make_shared have no manager
+extern "C" int no_dispose_make_shared_int(int v)
+{
+    auto p = sm_ptr::make_shared<int>(v);
+    return *p + 1;
+}
+
+extern "C" int no_dispose_make_shared_pod(int x, int y)
+{
+    auto p = sm_ptr::make_shared<Pod>(Pod{x, y});
+    return p->x + p->y;
+}
+
+// Other blocks call the manager of their type directly
+extern "C" int no_indirect_call_make_shared(int v)
+{
+    auto p = sm_ptr::make_shared<Counted>(v);
+    return p->val + 1;
+}
+
+extern "C" int no_indirect_call_deleter(int v)
+{
+    sm_ptr::shared_ptr<int> p(new int(v), CountingDelete());
+    return *p + 1;
+}
@@ -0,0 +1,27 @@
+#define SM_PTR_CHECK_BORROWS 0
+#include "shared_ref.h"
+
+// It is codegen checks for shared_ref, built by check_codegen.sh.
+// A handler chain passing the request down as a borrow:
+//   no_atomic_*  must not contain any atomic read-modify-write
+// Borrow checks are off here whatever NDEBUG is, so the handlers below take the
+// unchecked shared_ref and can only be linked with code built the same way.
+
+struct Request {
+    int id;
+};
+
+extern int log_request(sm_ptr::shared_ref<Request> req);
+extern int store_request(sm_ptr::shared_ref<const Request> req);
+
+extern "C" int no_atomic_handle(const sm_ptr::shared_ptr<Request>& req)
+{
+    sm_ptr::shared_ref<Request> ref(req);
+    return log_request(ref) + store_request(ref) + ref->id;
+}
+
+extern "C" int no_atomic_aliasing(const sm_ptr::shared_ptr<Request>& req)
+{
+    sm_ptr::shared_ref<int> id(req, &req->id);
+    return *id;
+}
@@ -0,0 +1,184 @@
+#include "unique_ptr.h"
+#include <cstdlib>
+#include <new>
+#include <utility>
+
+// It is codegen checks for unique_ptr, built by check_codegen.sh.
+// Each sm_* function does with unique_ptr what the raw_* function of the same name
+// does by hand with a raw pointer, and must not have more loads, stores, branches
+// or calls. unique_ptrs are taken by reference: passed by value they go through
+// memory, as the ABI requires for types with a non-trivial destructor.
+
+extern void on_destroy(int) noexcept;
+extern void use(int&) noexcept;
+
+struct Widget {
+    Widget(int _val) : val(_val) { }
+    ~Widget() { on_destroy(val); }
+    int val;
+};
+
+struct FreeDelete {
+    void operator()(int* p) const { std::free(p); }
+};
+
+// Destructor
+
+extern "C" void raw_destroy(Widget*& p)
+{
+    delete p;
+}
+
+extern "C" void sm_destroy(sm_ptr::unique_ptr<Widget>& p)
+{
+    p.~unique_ptr();
+}
+
+extern "C" void raw_destroy_array(int*& p)
+{
+    delete[] p;
+}
+
+extern "C" void sm_destroy_array(sm_ptr::unique_ptr<int[]>& p)
+{
+    p.~unique_ptr();
+}
+
+extern "C" void raw_destroy_deleter(int*& p)
+{
+    if (p != nullptr)
+        std::free(p);
+}
+
+extern "C" void sm_destroy_deleter(sm_ptr::unique_ptr<int, FreeDelete>& p)
+{
+    p.~unique_ptr();
+}
+
+// Construction and destruction in one scope
+
+extern "C" void raw_scope(int v)
+{
+    Widget* p = new Widget(v);
+    use(p->val);
+    delete p;
+}
+
+extern "C" void sm_scope(int v)
+{
+    auto p = sm_ptr::make_unique<Widget>(v);
+    use(p->val);
+}
+
+// Observers
+
+extern "C" int raw_deref(Widget* const& p)
+{
+    return p->val;
+}
+
+extern "C" int sm_deref(const sm_ptr::unique_ptr<Widget>& p)
+{
+    return p->val;
+}
+
+extern "C" bool raw_test(Widget* const& p)
+{
+    return p != nullptr;
+}
+
+extern "C" bool sm_test(const sm_ptr::unique_ptr<Widget>& p)
+{
+    return static_cast<bool>(p);
+}
+
+// Modifiers
+
+extern "C" Widget* raw_release(Widget*& p)
+{
+    Widget* r = p;
+    p = nullptr;
+    return r;
+}
+
+extern "C" Widget* sm_release(sm_ptr::unique_ptr<Widget>& p)
+{
+    return p.release();
+}
+
+extern "C" void raw_reset(Widget*& p, Widget* q)
+{
+    Widget* old = p;
+    p = q;
+    delete old;
+}
+
+extern "C" void sm_reset(sm_ptr::unique_ptr<Widget>& p, Widget* q)
+{
+    p.reset(q);
+}
+
+extern "C" void raw_assign_null(Widget*& p)
+{
+    Widget* old = p;
+    p = nullptr;
+    delete old;
+}
+
+extern "C" void sm_assign_null(sm_ptr::unique_ptr<Widget>& p)
+{
+    p = nullptr;
+}
+
+extern "C" void raw_swap(Widget*& p, Widget*& q)
+{
+    std::swap(p, q);
+}
+
+extern "C" void sm_swap(sm_ptr::unique_ptr<Widget>& p, sm_ptr::unique_ptr<Widget>& q)
+{
+    p.swap(q);
+}
+
+// Moves
+
+extern "C" void raw_move_construct(void* mem, Widget*& q)
+{
+    ::new (mem) Widget*(q);
+    q = nullptr;
+}
+
+extern "C" void sm_move_construct(void* mem, sm_ptr::unique_ptr<Widget>& q)
+{
+    ::new (mem) sm_ptr::unique_ptr<Widget>(std::move(q));
+}
+
+extern "C" void raw_move_assign(Widget*& p, Widget*& q)
+{
+    Widget* n = q;
+    q = nullptr;
+    Widget* old = p;
+    p = n;
+    delete old;
+}
+
+extern "C" void sm_move_assign(sm_ptr::unique_ptr<Widget>& p, sm_ptr::unique_ptr<Widget>& q)
+{
+    p = std::move(q);
+}
+
+extern "C" void raw_move_assign_deleter(int*& p, int*& q)
+{
+    int* n = q;
+    q = nullptr;
+    int* old = p;
+    p = n;
+    if (old != nullptr)
+        std::free(old);
+}
+
+extern "C" void sm_move_assign_deleter(sm_ptr::unique_ptr<int, FreeDelete>& p,
+                                       sm_ptr::unique_ptr<int, FreeDelete>& q)
+{
+    p = std::move(q);
+}
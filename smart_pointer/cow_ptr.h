@@ -0,0 +1,139 @@
+#ifndef COW_PTR_H
+#define COW_PTR_H
+
+#include <type_traits>
+#include <utility>
+#include "shared_ptr.h"
+
+namespace sm_ptr
+{
+    /*
+    * Copy-on-write pointer.
+    * Copies share the object through the shared_ptr control block, reads never copy,
+    * and the first mutable access clones the object if it is shared with another cow_ptr.
+    * The clone copy-constructs T, so the object must not be of a type derived from T.
+    */
+    template<typename T>
+    class cow_ptr
+    {
+        static_assert(std::is_copy_constructible<T>::value,
+                      "cow_ptr requires a copy constructible type");
+
+    private:
+        shared_ptr<T> _M_ptr;
+
+        template<typename Tp, typename ... Args>
+        friend cow_ptr<Tp> make_cow(Args&& ... args);
+
+        explicit cow_ptr(shared_ptr<T>&& p) noexcept
+            : _M_ptr(std::move(p)) { }
+
+        // Give *this its own copy of the object unless it already is the only owner
+        void _M_detach()
+        {
+            if (_M_ptr && !_M_ptr.unique())
+                _M_ptr = sm_ptr::make_shared<T>(*_M_ptr);
+        }
+
+    public:
+        using element_type = T;
+
+        //  Constructors
+
+        constexpr cow_ptr() noexcept = default;
+
+        constexpr cow_ptr(std::nullptr_t) noexcept
+            : _M_ptr() { }
+
+        explicit cow_ptr(T* p)
+            : _M_ptr(p) { }
+
+        cow_ptr(const cow_ptr&) noexcept = default;
+        cow_ptr(cow_ptr&&) noexcept = default;
+
+        // Assignment
+
+        cow_ptr& operator=(const cow_ptr&) noexcept = default;
+        cow_ptr& operator=(cow_ptr&&) noexcept = default;
+
+        cow_ptr& operator=(std::nullptr_t) noexcept
+        {
+            _M_ptr.reset();
+            return *this;
+        }
+
+        // Observers, read access never copies
+
+        /// Dereference the stored pointer
+        const T& operator*() const noexcept
+        {
+            return *_M_ptr;
+        }
+
+        /// Return the stored pointer
+        const T* operator->() const noexcept
+        {
+            return _M_ptr.get();
+        }
+
+        /// Return the stored pointer
+        const T* get() const noexcept
+        {
+            return _M_ptr.get();
+        }
+
+        /// Return true if the stored pointer is not null
+        explicit operator bool() const noexcept
+        {
+            return (bool)_M_ptr;
+        }
+
+        /// Return true if no other cow_ptr shares the object
+        bool unique() const noexcept
+        {
+            return _M_ptr.unique();
+        }
+
+        /// Return the number of cow_ptrs sharing the object
+        long use_count() const noexcept
+        {
+            return _M_ptr.use_count();
+        }
+
+        // Mutable access
+
+        /// Return a pointer to an object owned by *this alone, cloning it if it is shared
+        T* get_mutable()
+        {
+            _M_detach();
+            return _M_ptr.get();
+        }
+
+        // Modifiers
+
+        void reset() noexcept
+        {
+            _M_ptr.reset();
+        }
+
+        void swap(cow_ptr& other) noexcept
+        {
+            _M_ptr.swap(other._M_ptr);
+        }
+    };
+
+    /// Construct the object and its control block together
+    template<typename T, typename ... Args>
+    inline cow_ptr<T> make_cow(Args&& ... args)
+    {
+        return cow_ptr<T>(sm_ptr::make_shared<T>(std::forward<Args>(args)...));
+    }
+
+    template<typename T>
+    inline void swap(cow_ptr<T>& lhs, cow_ptr<T>& rhs) noexcept
+    {
+        lhs.swap(rhs);
+    }
+}
+
+#endif // COW_PTR_H
@@ -0,0 +1,212 @@
+#ifndef LAZY_PTR_H
+#define LAZY_PTR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include "unique_ptr.h"
+
+namespace sm_ptr
+{
+    // Default factory of lazy_ptr, value-initializes the object
+    template<typename T>
+    class default_lazy_factory
+    {
+    public:
+        unique_ptr<T> operator()() const
+        {
+            return sm_ptr::make_unique<T>();
+        }
+    };
+
+    /*
+    * Where threads wait for a lazy_ptr which another thread is constructing.
+    * A few mutexes and condition variables are shared by all lazy_ptrs, picked by address,
+    * so that a lazy_ptr carries none of its own for a wait which happens at most once.
+    */
+    class _Lazy_waiters
+    {
+    public:
+        std::mutex              _M_mutex;
+        std::condition_variable _M_cond;
+
+        static _Lazy_waiters& _S_for(const void* p) noexcept
+        {
+            static _Lazy_waiters waiters[16];
+            return waiters[(reinterpret_cast<std::uintptr_t>(p) / 64) % 16];
+        }
+    };
+
+    /*
+    * Owning pointer which constructs its object on first access.
+    * The factory returns the object as a unique_ptr<T> and runs at most once, even when
+    * several threads reach get() together: one of them constructs while the others block.
+    * If the factory throws, the next access tries again.
+    * Once the object exists get() is a single acquire load, so lazy_ptr can replace
+    * unique_ptr members which are expensive to construct and often never used.
+    * Moving, reset() and extract() are not thread-safe, like for unique_ptr.
+    */
+    template<typename T, typename Factory = default_lazy_factory<T>>
+    class lazy_ptr
+    {
+    private:
+        enum _State : unsigned char { _S_idle, _S_busy };
+
+        // Construction does not change the value of a lazy_ptr, so const ones construct too
+        mutable std::atomic<T*>      _M_ptr;
+        mutable std::atomic<_State>  _M_state;
+        mutable Factory              _M_factory;
+
+        // The object is deleted as a T, so the factory must not bring a deleter of its own
+        static_assert(std::is_convertible<decltype(std::declval<Factory&>()()), unique_ptr<T>>::value,
+                      "the factory of lazy_ptr<T> must return unique_ptr<T>");
+
+        // Leave the busy state and wake the waiters, under the mutex so none misses the wakeup
+        void _M_finish() const noexcept
+        {
+            _Lazy_waiters& waiters = _Lazy_waiters::_S_for(this);
+            {
+                std::lock_guard<std::mutex> lock(waiters._M_mutex);
+                _M_state.store(_S_idle, std::memory_order_release);
+            }
+            waiters._M_cond.notify_all();
+        }
+
+        // Slow path of get(), kept apart so the fast path inlines to a load and a test
+        T* _M_construct() const
+        {
+            for (;;)
+            {
+                _State idle = _S_idle;
+                if (_M_state.compare_exchange_strong(idle, _S_busy, std::memory_order_acquire))
+                {
+                    T* p = _M_ptr.load(std::memory_order_relaxed);
+                    if (p == nullptr)
+                    {
+                        try
+                        {
+                            p = unique_ptr<T>(_M_factory()).release();
+                        }
+                        catch (...)
+                        {
+                            _M_finish();
+                            throw;
+                        }
+                        _M_ptr.store(p, std::memory_order_release);
+                    }
+                    _M_finish();
+                    return p;
+                }
+
+                // Another thread is constructing, block until it publishes or gives up
+                {
+                    _Lazy_waiters& waiters = _Lazy_waiters::_S_for(this);
+                    std::unique_lock<std::mutex> lock(waiters._M_mutex);
+                    waiters._M_cond.wait(lock, [this] {
+                        return _M_state.load(std::memory_order_acquire) != _S_busy;
+                    });
+                }
+                if (T* p = _M_ptr.load(std::memory_order_acquire))
+                    return p;
+            }
+        }
+
+    public:
+        using element_type = T;
+        using pointer      = T*;
+        using factory_type = Factory;
+
+        // Constructors
+
+        lazy_ptr()
+            : _M_ptr(nullptr), _M_state(_S_idle), _M_factory() { }
+
+        explicit lazy_ptr(Factory factory)
+            : _M_ptr(nullptr), _M_state(_S_idle), _M_factory(std::move(factory)) { }
+
+        lazy_ptr(lazy_ptr&& r) noexcept(std::is_nothrow_move_constructible<Factory>::value)
+            : _M_ptr(r._M_ptr.exchange(nullptr, std::memory_order_relaxed)),
+              _M_state(_S_idle), _M_factory(std::move(r._M_factory)) { }
+
+        lazy_ptr& operator=(lazy_ptr&& r)
+        {
+            reset(r._M_ptr.exchange(nullptr, std::memory_order_relaxed));
+            _M_factory = std::move(r._M_factory);
+            return *this;
+        }
+
+        // Destructor
+        ~lazy_ptr()
+        {
+            delete _M_ptr.load(std::memory_order_relaxed);
+        }
+
+        // Observers
+
+        /// Return the object, constructing it on first use
+        T* get() const
+        {
+            T* p = _M_ptr.load(std::memory_order_acquire);
+            if (p != nullptr)
+                return p;
+            return _M_construct();
+        }
+
+        T& operator*() const
+        {
+            return *get();
+        }
+
+        T* operator->() const
+        {
+            return get();
+        }
+
+        /// Return true if the object has been constructed, without constructing it
+        bool constructed() const noexcept
+        {
+            return _M_ptr.load(std::memory_order_acquire) != nullptr;
+        }
+
+        Factory& get_factory() noexcept
+        {
+            return _M_factory;
+        }
+
+        const Factory& get_factory() const noexcept
+        {
+            return _M_factory;
+        }
+
+        // Modifiers
+
+        /// Hand the object over to a unique_ptr, constructing it first if needed.
+        /// The next access constructs a new object.
+        unique_ptr<T> extract()
+        {
+            get();
+            return unique_ptr<T>(_M_ptr.exchange(nullptr, std::memory_order_relaxed));
+        }
+
+        /// Destroy the object if any and own @p p instead, a null @p p makes the next access construct
+        void reset(T* p = nullptr) noexcept
+        {
+            delete _M_ptr.exchange(p, std::memory_order_acq_rel);
+        }
+
+        lazy_ptr(const lazy_ptr&) = delete;
+        lazy_ptr& operator=(const lazy_ptr&) = delete;
+    };
+
+    /// Make a lazy_ptr from a factory returning unique_ptr<T>, e.g. a lambda
+    template<typename T, typename Factory>
+    inline lazy_ptr<T, typename std::decay<Factory>::type> make_lazy(Factory&& factory)
+    {
+        return lazy_ptr<T, typename std::decay<Factory>::type>(std::forward<Factory>(factory));
+    }
+}
+
+#endif // LAZY_PTR_H
@@ -0,0 +1,333 @@
+#ifndef MMAP_ARENA_H
+#define MMAP_ARENA_H
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "offset_ptr.h"
+#include "unique_ptr.h"
+
+namespace sm_ptr
+{
+    /*
+    * Header at the start of an arena file.
+    * Everything in it is an offset from the header, so the allocator state is valid
+    * wherever the file is mapped and a deleter stored in the file can reach it.
+    * Blocks are carved from _M_top in power of two size classes and freed blocks
+    * are kept on one free list per class.
+    */
+    class _Arena_header
+    {
+    public:
+        static constexpr std::uint64_t _S_magic   = 0x616e6572615f6d73;   // "sm_arena"
+        static constexpr std::size_t   _S_align   = 16;
+        static constexpr unsigned      _S_classes = 48;
+
+        explicit _Arena_header(std::uint64_t capacity) noexcept
+            : _M_magic(_S_magic), _M_capacity(capacity), _M_top(sizeof(_Arena_header)), _M_root(0)
+        {
+            for (auto& head : _M_free)
+                head = 0;
+        }
+
+        bool _M_valid(std::uint64_t file_size) const noexcept
+        {
+            return _M_magic == _S_magic && _M_capacity == file_size && _M_top <= _M_capacity;
+        }
+
+        /// Allocate n bytes aligned to _S_align, throw std::bad_alloc when the arena is full
+        void* _M_allocate(std::size_t n)
+        {
+            unsigned cls = _S_class_of(n);
+            if (cls >= _S_classes)
+                throw std::bad_alloc();
+
+            _Block* block;
+            if (_M_free[cls] != 0)
+            {
+                block = _M_at<_Block>(_M_free[cls]);
+                _M_free[cls] = block->_M_next;
+            }
+            else
+            {
+                std::uint64_t size = sizeof(_Block) + (std::uint64_t(_S_align) << cls);
+                if (size > _M_capacity - _M_top)
+                    throw std::bad_alloc();
+                block = _M_at<_Block>(_M_top);
+                block->_M_class = cls;
+                _M_top += size;
+            }
+            return block + 1;
+        }
+
+        void _M_deallocate(void* p) noexcept
+        {
+            _Block* block = static_cast<_Block*>(p) - 1;
+            block->_M_next = _M_free[block->_M_class];
+            _M_free[block->_M_class] = _M_offset_of(block);
+        }
+
+        void* _M_get_root() noexcept
+        {
+            return _M_root != 0 ? _M_at<char>(_M_root) : nullptr;
+        }
+
+        void _M_set_root(void* p) noexcept
+        {
+            _M_root = p != nullptr ? _M_offset_of(p) : 0;
+        }
+
+        std::uint64_t _M_used() const noexcept
+        {
+            return _M_top;
+        }
+
+    private:
+        struct alignas(_S_align) _Block
+        {
+            std::uint64_t _M_class;
+            std::uint64_t _M_next;     // offset of the next free block of the class while free
+        };
+
+        static unsigned _S_class_of(std::size_t n) noexcept
+        {
+            unsigned cls = 0;
+            while ((std::size_t(_S_align) << cls) < n && cls < _S_classes)
+                ++cls;
+            return cls;
+        }
+
+        template<typename U>
+        U* _M_at(std::uint64_t off) noexcept
+        {
+            return reinterpret_cast<U*>(reinterpret_cast<char*>(this) + off);
+        }
+
+        std::uint64_t _M_offset_of(const void* p) const noexcept
+        {
+            return static_cast<const char*>(p) - reinterpret_cast<const char*>(this);
+        }
+
+        std::uint64_t _M_magic;
+        std::uint64_t _M_capacity;
+        std::uint64_t _M_top;
+        std::uint64_t _M_root;
+        std::uint64_t _M_free[_S_classes];
+    };
+
+    /*
+    * Deleter of objects allocated in an mmap_arena.
+    * Its pointer type is offset_ptr and it refers to the arena through an offset_ptr,
+    * so unique_ptrs using it can be stored inside the arena and survive remapping.
+    */
+    template<typename T>
+    class arena_delete
+    {
+    private:
+        offset_ptr<_Arena_header> _M_arena;
+
+        template<typename U> friend class arena_delete;
+
+    public:
+        using pointer = offset_ptr<T>;
+
+        arena_delete() noexcept = default;
+
+        explicit arena_delete(_Arena_header* arena) noexcept
+            : _M_arena(arena) { }
+
+        template<typename U, typename = typename
+            std::enable_if<std::is_convertible<U*, T*>::value>::type>
+        arena_delete(const arena_delete<U>& d) noexcept
+            : _M_arena(d._M_arena) { }
+
+        void operator()(pointer ptr) const
+        {
+            static_assert(sizeof(T) > 0,
+                          "can't delete pointer to incomplete type");
+            T* p = ptr.get();
+            p->~T();
+            _M_arena->_M_deallocate(p);
+        }
+    };
+
+    template<typename T>
+    using arena_unique_ptr = unique_ptr<T, arena_delete<T>>;
+
+    /*
+    * A file mapped into memory and used as an allocation arena.
+    * Opening an existing arena file maps it back with all its objects in place,
+    * as long as they only point into the arena through offset_ptr and were written
+    * by a build with the same object layout. Not thread-safe.
+    */
+    class mmap_arena
+    {
+    private:
+        _Arena_header* _M_header = nullptr;
+        std::size_t    _M_size = 0;
+        bool           _M_created = false;
+
+        [[noreturn]] static void _S_throw(const char* what)
+        {
+            throw std::system_error(errno, std::generic_category(), what);
+        }
+
+    public:
+        // Constructors
+
+        /// Open the arena file at @p path, or create one of @p capacity bytes if it does not exist
+        mmap_arena(const char* path, std::size_t capacity)
+        {
+            int fd = ::open(path, O_RDWR | O_CREAT, 0644);
+            if (fd < 0)
+                _S_throw("mmap_arena: open");
+
+            struct stat st;
+            if (::fstat(fd, &st) != 0)
+            {
+                ::close(fd);
+                _S_throw("mmap_arena: fstat");
+            }
+
+            _M_created = st.st_size == 0;
+            _M_size = _M_created ? capacity : static_cast<std::size_t>(st.st_size);
+            if (_M_size < sizeof(_Arena_header))
+            {
+                ::close(fd);
+                throw std::invalid_argument("mmap_arena: capacity smaller than the arena header");
+            }
+            if (_M_created && ::ftruncate(fd, _M_size) != 0)
+            {
+                ::close(fd);
+                _S_throw("mmap_arena: ftruncate");
+            }
+
+            void* base = ::mmap(nullptr, _M_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (base == MAP_FAILED)
+                _S_throw("mmap_arena: mmap");
+
+            if (_M_created)
+                _M_header = ::new (base) _Arena_header(_M_size);
+            else
+                _M_header = static_cast<_Arena_header*>(base);
+
+            if (!_M_header->_M_valid(_M_size))
+            {
+                ::munmap(base, _M_size);
+                throw std::runtime_error("mmap_arena: not an arena file");
+            }
+        }
+
+        mmap_arena(mmap_arena&& r) noexcept
+            : _M_header(r._M_header), _M_size(r._M_size), _M_created(r._M_created)
+        {
+            r._M_header = nullptr;
+        }
+
+        mmap_arena& operator=(mmap_arena&& r) noexcept
+        {
+            std::swap(_M_header, r._M_header);
+            std::swap(_M_size, r._M_size);
+            std::swap(_M_created, r._M_created);
+            return *this;
+        }
+
+        // Destructor, the contents stay in the file
+        ~mmap_arena()
+        {
+            if (_M_header != nullptr)
+                ::munmap(_M_header, _M_size);
+        }
+
+        // Observers
+
+        /// Return true if the constructor created a new arena file
+        bool created() const noexcept
+        {
+            return _M_created;
+        }
+
+        /// Return the number of bytes of the file in use
+        std::size_t used() const noexcept
+        {
+            return _M_header->_M_used();
+        }
+
+        /// Return the root object, or null if none has been set
+        template<typename T>
+        T* root() const noexcept
+        {
+            return static_cast<T*>(_M_header->_M_get_root());
+        }
+
+        // Modifiers
+
+        /// Record the object to return from root() when the arena is opened again
+        template<typename T>
+        void set_root(T* p) noexcept
+        {
+            _M_header->_M_set_root(p);
+        }
+
+        void* allocate(std::size_t n)
+        {
+            return _M_header->_M_allocate(n);
+        }
+
+        void deallocate(void* p) noexcept
+        {
+            _M_header->_M_deallocate(p);
+        }
+
+        /// Write the mapped pages back to the file
+        void sync()
+        {
+            if (::msync(_M_header, _M_size, MS_SYNC) != 0)
+                _S_throw("mmap_arena: msync");
+        }
+
+        /// Return the deleter releasing objects of this arena
+        template<typename T>
+        arena_delete<T> deleter() const noexcept
+        {
+            return arena_delete<T>(_M_header);
+        }
+
+        mmap_arena(const mmap_arena&) = delete;
+        mmap_arena& operator=(const mmap_arena&) = delete;
+    };
+
+    /// Construct an object in the arena, owned by a unique_ptr with an offset_ptr pointer
+    template<typename T, typename ... Args>
+    inline arena_unique_ptr<T> make_arena_unique(mmap_arena& arena, Args&& ... args)
+    {
+        static_assert(!std::is_array<T>::value,
+                      "make_arena_unique of an array type");
+        static_assert(alignof(T) <= _Arena_header::_S_align,
+                      "over-aligned type in mmap_arena");
+        void* mem = arena.allocate(sizeof(T));
+        T* p;
+        try
+        {
+            p = ::new (mem) T(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            arena.deallocate(mem);
+            throw;
+        }
+        return arena_unique_ptr<T>(p, arena.deleter<T>());
+    }
+}
+
+#endif // MMAP_ARENA_H
@@ -0,0 +1,324 @@
+#ifndef OBJECT_POOL_H
+#define OBJECT_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "shared_ptr.h"
+#include "unique_ptr.h"
+
+namespace sm_ptr
+{
+    // Default reset policy of object_pool, calls clear() on the object if T has one
+    template<typename T>
+    class pool_reset
+    {
+    private:
+        // Use SFINAE to determine whether T::clear() exists, whatever it returns
+        template<typename U>
+        static decltype((void)std::declval<U&>().clear(), std::true_type()) __test(int);
+
+        template<typename U>
+        static std::false_type __test(...);
+
+        static void _S_reset(T& obj, std::true_type)
+        {
+            obj.clear();
+        }
+
+        static void _S_reset(T&, std::false_type) { }
+
+    public:
+        void operator()(T& obj) const
+        {
+            _S_reset(obj, decltype(__test<T>(0))());
+        }
+    };
+
+    // An object kept alive between uses, T lives at the start of the node
+    template<typename T>
+    struct _Pool_node
+    {
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type _M_storage;
+        _Pool_node*                                               _M_next;
+
+        T* _M_ptr() noexcept
+        {
+            return reinterpret_cast<T*>(&_M_storage);
+        }
+
+        static _Pool_node* _S_from(T* p) noexcept
+        {
+            return reinterpret_cast<_Pool_node*>(p);
+        }
+    };
+
+    /*
+    * State shared by an object_pool and the thread caches holding its objects.
+    * Every node ever constructed is recorded in _M_nodes and destroyed with the core.
+    * Objects returned beyond a thread's cache capacity go to _M_overflow,
+    * a lock-free list which is only ever pushed to or taken as a whole, so it has no ABA.
+    */
+    template<typename T, typename Reset>
+    class _Pool_core
+    {
+    public:
+        using _Node = _Pool_node<T>;
+
+        _Pool_core(std::size_t local_capacity, Reset reset)
+            : _M_id(_S_next_id()), _M_overflow(nullptr),
+              _M_reset(std::move(reset)), _M_local_capacity(local_capacity) { }
+
+        ~_Pool_core()
+        {
+            for (_Node* node : _M_nodes)
+            {
+                node->_M_ptr()->~T();
+                delete node;
+            }
+        }
+
+        /// Construct a new object, on the slow path only
+        _Node* _M_new_node()
+        {
+            _Node* node = new _Node;
+            try
+            {
+                ::new (static_cast<void*>(&node->_M_storage)) T();
+            }
+            catch (...)
+            {
+                delete node;
+                throw;
+            }
+            try
+            {
+                std::lock_guard<std::mutex> lock(_M_mutex);
+                _M_nodes.push_back(node);
+            }
+            catch (...)
+            {
+                node->_M_ptr()->~T();
+                delete node;
+                throw;
+            }
+            return node;
+        }
+
+        /// Push the chain first..last to the overflow list
+        void _M_push_overflow(_Node* first, _Node* last) noexcept
+        {
+            _Node* head = _M_overflow.load(std::memory_order_relaxed);
+            do
+            {
+                last->_M_next = head;
+            } while (!_M_overflow.compare_exchange_weak(head, first,
+                                                        std::memory_order_release,
+                                                        std::memory_order_relaxed));
+        }
+
+        /// Take the whole overflow list
+        _Node* _M_take_overflow() noexcept
+        {
+            if (_M_overflow.load(std::memory_order_relaxed) == nullptr)
+                return nullptr;
+            return _M_overflow.exchange(nullptr, std::memory_order_acquire);
+        }
+
+        const std::uint64_t            _M_id;
+        weak_ptr<_Pool_core>           _M_self;
+        std::atomic<_Node*>            _M_overflow;
+        Reset                          _M_reset;
+        const std::size_t              _M_local_capacity;
+
+    private:
+        static std::uint64_t _S_next_id() noexcept
+        {
+            static std::atomic<std::uint64_t> next(1);
+            return next.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        std::mutex          _M_mutex;
+        std::vector<_Node*> _M_nodes;
+    };
+
+    /*
+    * Free list of the calling thread, one per object type.
+    * It belongs to one pool at a time, identified by an id that is never reused,
+    * and hands its objects back to that pool when it switches pools or its thread exits.
+    */
+    template<typename T, typename Reset>
+    class _Pool_local
+    {
+    public:
+        using _Core = _Pool_core<T, Reset>;
+        using _Node = _Pool_node<T>;
+
+        static _Pool_local& _S_get() noexcept
+        {
+            static thread_local _Pool_local local;
+            return local;
+        }
+
+        ~_Pool_local()
+        {
+            _M_flush();
+        }
+
+        _Node* _M_pop(_Core& core)
+        {
+            if (_M_id != core._M_id)
+                _M_bind(core);
+            if (_M_head == nullptr)
+                _M_refill(core);
+            if (_M_head == nullptr)
+                return core._M_new_node();
+            _Node* node = _M_head;
+            _M_head = node->_M_next;
+            --_M_count;
+            return node;
+        }
+
+        void _M_push(_Core& core, _Node* node) noexcept
+        {
+            if (_M_id != core._M_id)
+                _M_bind(core);
+            node->_M_next = _M_head;
+            _M_head = node;
+            // Spill half the cache, but at least enough to get back within capacity
+            if (++_M_count > core._M_local_capacity)
+                _M_spill(core, std::max(_M_count / 2, _M_count - core._M_local_capacity));
+        }
+
+    private:
+        // Hand the cached objects back to the previous pool if it is alive, then switch to core
+        void _M_bind(_Core& core) noexcept
+        {
+            _M_flush();
+            _M_id = core._M_id;
+            _M_core = core._M_self;
+        }
+
+        void _M_flush() noexcept
+        {
+            if (_M_head != nullptr)
+            {
+                // A destroyed pool has already freed these nodes
+                if (auto core = _M_core.lock())
+                    _M_spill(*core, _M_count);
+            }
+            _M_head = nullptr;
+            _M_count = 0;
+        }
+
+        // Move the first n cached nodes to the overflow list of core
+        void _M_spill(_Core& core, std::size_t n) noexcept
+        {
+            if (n == 0)
+                return;
+            _Node* first = _M_head;
+            _Node* last = first;
+            for (std::size_t i = 1; i < n; ++i)
+                last = last->_M_next;
+            _M_head = last->_M_next;
+            _M_count -= n;
+            core._M_push_overflow(first, last);
+        }
+
+        void _M_refill(_Core& core) noexcept
+        {
+            _M_head = core._M_take_overflow();
+            for (_Node* node = _M_head; node != nullptr; node = node->_M_next)
+                ++_M_count;
+        }
+
+        std::uint64_t  _M_id    = 0;
+        weak_ptr<_Core> _M_core;
+        _Node*         _M_head  = nullptr;
+        std::size_t    _M_count = 0;
+    };
+
+    // Deleter of the pointers handed out by object_pool, resets the object and returns it
+    template<typename T, typename Reset = pool_reset<T>>
+    class pool_return
+    {
+    public:
+        constexpr pool_return() noexcept
+            : _M_core(nullptr) { }
+
+        explicit pool_return(_Pool_core<T, Reset>* core) noexcept
+            : _M_core(core) { }
+
+        void operator()(T* ptr) const noexcept
+        {
+            _M_core->_M_reset(*ptr);
+            _Pool_local<T, Reset>::_S_get()._M_push(*_M_core, _Pool_node<T>::_S_from(ptr));
+        }
+
+    private:
+        _Pool_core<T, Reset>* _M_core;
+    };
+
+    /*
+    * Pool of value-initialized objects that are reset and recycled instead of destroyed,
+    * so their already-constructed internals such as reserved buffers are reused.
+    * Returned objects go to a free list of the returning thread, holding at most
+    * local_capacity objects, and the excess goes to a lock-free list shared by all threads.
+    * Every object must have been returned before the pool is destroyed.
+    */
+    template<typename T, typename Reset = pool_reset<T>>
+    class object_pool
+    {
+        static_assert(!std::is_array<T>::value,
+                      "object_pool of an array type");
+
+    private:
+        using _Core  = _Pool_core<T, Reset>;
+        using _Local = _Pool_local<T, Reset>;
+
+        shared_ptr<_Core> _M_core;
+
+    public:
+        using element_type = T;
+        using deleter_type = pool_return<T, Reset>;
+        using pointer      = unique_ptr<T, deleter_type>;
+
+        explicit object_pool(std::size_t local_capacity = 64, Reset reset = Reset())
+            : _M_core(sm_ptr::make_shared<_Core>(local_capacity, std::move(reset)))
+        {
+            _M_core->_M_self = _M_core;
+        }
+
+        object_pool(const object_pool&) = delete;
+        object_pool& operator=(const object_pool&) = delete;
+
+        /// Take an object from the pool, constructing one if the pool is empty
+        pointer acquire()
+        {
+            auto node = _Local::_S_get()._M_pop(*_M_core);
+            return pointer(node->_M_ptr(), deleter_type(_M_core.get()));
+        }
+
+        /// Take an object from the pool as a shared_ptr, the control block is still allocated
+        shared_ptr<T> acquire_shared()
+        {
+            return shared_ptr<T>(acquire());
+        }
+
+        /// Construct n objects ahead of time
+        void reserve(std::size_t n)
+        {
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                auto node = _M_core->_M_new_node();
+                _M_core->_M_push_overflow(node, node);
+            }
+        }
+    };
+}
+
+#endif // OBJECT_POOL_H
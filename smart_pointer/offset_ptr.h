@@ -0,0 +1,186 @@
+#ifndef OFFSET_PTR_H
+#define OFFSET_PTR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+
+namespace sm_ptr
+{
+    /*
+    * Pointer storing the distance from itself to its target, so that a structure made of
+    * offset_ptrs keeps pointing into itself wherever it is mapped.
+    * It can be used as the pointer type of a unique_ptr deleter.
+    * An offset of 1 stands for null, the target can never start one byte into the pointer.
+    */
+    template<typename T>
+    class offset_ptr
+    {
+    private:
+        static constexpr std::ptrdiff_t _S_null = 1;
+
+        std::ptrdiff_t _M_off;
+
+        template<typename U> friend class offset_ptr;
+
+        std::ptrdiff_t _M_offset_to(const volatile void* p) const noexcept
+        {
+            if (p == nullptr)
+                return _S_null;
+            return reinterpret_cast<std::intptr_t>(p) - reinterpret_cast<std::intptr_t>(this);
+        }
+
+    public:
+        using element_type    = T;
+        using pointer         = T*;
+        using difference_type = std::ptrdiff_t;
+
+        // Constructors
+
+        offset_ptr() noexcept
+            : _M_off(_S_null) { }
+
+        offset_ptr(std::nullptr_t) noexcept
+            : _M_off(_S_null) { }
+
+        offset_ptr(T* p) noexcept
+            : _M_off(_M_offset_to(p)) { }
+
+        // The offset is relative to this object, so copies recompute it
+        offset_ptr(const offset_ptr& r) noexcept
+            : _M_off(_M_offset_to(r.get())) { }
+
+        template<typename U, typename = typename
+            std::enable_if<std::is_convertible<U*, T*>::value>::type>
+        offset_ptr(const offset_ptr<U>& r) noexcept
+            : _M_off(_M_offset_to(static_cast<T*>(r.get()))) { }
+
+        // Assignment
+
+        offset_ptr& operator=(const offset_ptr& r) noexcept
+        {
+            _M_off = _M_offset_to(r.get());
+            return *this;
+        }
+
+        template<typename U, typename = typename
+            std::enable_if<std::is_convertible<U*, T*>::value>::type>
+        offset_ptr& operator=(const offset_ptr<U>& r) noexcept
+        {
+            _M_off = _M_offset_to(static_cast<T*>(r.get()));
+            return *this;
+        }
+
+        offset_ptr& operator=(T* p) noexcept
+        {
+            _M_off = _M_offset_to(p);
+            return *this;
+        }
+
+        offset_ptr& operator=(std::nullptr_t) noexcept
+        {
+            _M_off = _S_null;
+            return *this;
+        }
+
+        // Observers
+
+        /// Return the raw pointer to the target
+        T* get() const noexcept
+        {
+            if (_M_off == _S_null)
+                return nullptr;
+            return reinterpret_cast<T*>(reinterpret_cast<std::intptr_t>(this) + _M_off);
+        }
+
+        /// Dereference the stored pointer
+        typename std::add_lvalue_reference<T>::type operator*() const noexcept
+        {
+            return *get();
+        }
+
+        /// Return the stored pointer
+        T* operator->() const noexcept
+        {
+            return get();
+        }
+
+        /// Access an element of the array pointed to
+        template<typename U = T>
+        typename std::add_lvalue_reference<U>::type operator[](std::ptrdiff_t i) const noexcept
+        {
+            return get()[i];
+        }
+
+        /// Return true if the stored pointer is not null
+        explicit operator bool() const noexcept
+        {
+            return _M_off != _S_null;
+        }
+
+        /// Used by std::pointer_traits
+        static offset_ptr pointer_to(typename std::add_lvalue_reference<T>::type r) noexcept
+        {
+            return offset_ptr(&r);
+        }
+    };
+
+    template<typename T1, typename T2>
+    inline bool operator==(const offset_ptr<T1>& x, const offset_ptr<T2>& y) noexcept
+    {
+        return x.get() == y.get();
+    }
+
+    template<typename T1, typename T2>
+    inline bool operator!=(const offset_ptr<T1>& x, const offset_ptr<T2>& y) noexcept
+    {
+        return x.get() != y.get();
+    }
+
+    template<typename T1, typename T2>
+    inline bool operator<(const offset_ptr<T1>& x, const offset_ptr<T2>& y) noexcept
+    {
+        using CT = typename std::common_type<T1*, T2*>::type;
+        return std::less<CT>()(x.get(), y.get());
+    }
+
+    template<typename T>
+    inline bool operator==(const offset_ptr<T>& x, std::nullptr_t) noexcept
+    {
+        return !x;
+    }
+
+    template<typename T>
+    inline bool operator==(std::nullptr_t, const offset_ptr<T>& x) noexcept
+    {
+        return !x;
+    }
+
+    template<typename T>
+    inline bool operator!=(const offset_ptr<T>& x, std::nullptr_t) noexcept
+    {
+        return (bool)x;
+    }
+
+    template<typename T>
+    inline bool operator!=(std::nullptr_t, const offset_ptr<T>& x) noexcept
+    {
+        return (bool)x;
+    }
+}
+
+namespace std
+{
+    // Hash of the target address, so unique_ptr_hash works with offset_ptr pointers
+    template<typename T>
+    struct hash<sm_ptr::offset_ptr<T>>
+    {
+        std::size_t operator()(const sm_ptr::offset_ptr<T>& p) const noexcept
+        {
+            return std::hash<T*>()(p.get());
+        }
+    };
+}
+
+#endif // OFFSET_PTR_H
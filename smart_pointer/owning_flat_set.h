@@ -0,0 +1,424 @@
+#ifndef OWNING_FLAT_SET_H
+#define OWNING_FLAT_SET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <utility>
+#include "ptr_hash.h"
+#include "unique_ptr.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace sm_ptr
+{
+    /*
+    * Control bytes of owning_flat_set, one per slot, probed 16 at a time.
+    * A full slot holds the top 7 bits of its hash, an empty or deleted one a negative marker.
+    */
+    struct _Flat_ctrl
+    {
+        static constexpr std::size_t _S_width   = 16;
+        static constexpr signed char _S_empty   = -128;
+        static constexpr signed char _S_deleted = -2;
+
+        /// Bit i is set when ctrl[i] == b
+        static std::uint32_t _S_match(const signed char* ctrl, signed char b) noexcept
+        {
+#ifdef __SSE2__
+            __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+            return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(b), group)));
+#else
+            std::uint32_t mask = 0;
+            for (std::size_t i = 0; i < _S_width; ++i)
+                mask |= std::uint32_t(ctrl[i] == b) << i;
+            return mask;
+#endif
+        }
+
+        /// Bit i is set when slot i is empty or deleted
+        static std::uint32_t _S_match_free(const signed char* ctrl) noexcept
+        {
+#ifdef __SSE2__
+            __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+            return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1), group)));
+#else
+            std::uint32_t mask = 0;
+            for (std::size_t i = 0; i < _S_width; ++i)
+                mask |= std::uint32_t(ctrl[i] < -1) << i;
+            return mask;
+#endif
+        }
+
+        static unsigned _S_lowest(std::uint32_t mask) noexcept
+        {
+            return static_cast<unsigned>(__builtin_ctz(mask));
+        }
+    };
+
+    /*
+    * Open-addressing set owning its elements through unique_ptr, stored inline in the table.
+    * Elements are identified by address and looked up with any pointer key (raw pointer,
+    * unique_ptr or shared_ptr) through ptr_hash and ptr_equal, without a temporary owner.
+    * Slots are probed a group of 16 control bytes at a time, with SSE2 when available.
+    * Inserting may move the unique_ptrs, but never the objects they own.
+    */
+    template<typename T, typename Deleter = default_delete<T>>
+    class owning_flat_set
+    {
+    public:
+        using value_type = unique_ptr<T, Deleter>;
+        using size_type  = std::size_t;
+
+    private:
+        using _Ctrl = _Flat_ctrl;
+
+        static constexpr size_type _S_npos = size_type(-1);
+
+        unique_ptr<signed char[]> _M_ctrl;
+        value_type*               _M_slots    = nullptr;
+        size_type                 _M_capacity = 0;     // 0 or a power of two multiple of 16
+        size_type                 _M_size     = 0;
+        size_type                 _M_deleted  = 0;
+
+        static signed char _S_tag(std::size_t hash) noexcept
+        {
+            return static_cast<signed char>(hash >> (sizeof(std::size_t) * 8 - 7));
+        }
+
+        /*
+        * Probe the groups from the one selected by the low bits of the hash,
+        * by triangular steps which visit every group when their number is a power of two.
+        */
+        template<typename Key>
+        size_type _M_find(const Key& key, std::size_t hash) const noexcept
+        {
+            if (_M_capacity == 0)
+                return _S_npos;
+            const volatile void* addr = _Ptr_address::_S_get(key);
+            signed char tag = _S_tag(hash);
+            size_type mask = _M_capacity / _Ctrl::_S_width - 1;
+            size_type group = hash & mask;
+            for (size_type step = 1; ; ++step)
+            {
+                const signed char* ctrl = _M_ctrl.get() + group * _Ctrl::_S_width;
+                for (std::uint32_t m = _Ctrl::_S_match(ctrl, tag); m != 0; m &= m - 1)
+                {
+                    size_type i = group * _Ctrl::_S_width + _Ctrl::_S_lowest(m);
+                    if (_M_slots[i].get() == addr)
+                        return i;
+                }
+                if (_Ctrl::_S_match(ctrl, _Ctrl::_S_empty) != 0)
+                    return _S_npos;
+                group = (group + step) & mask;
+            }
+        }
+
+        // First empty or deleted slot on the probe sequence of hash
+        size_type _M_find_free(std::size_t hash) const noexcept
+        {
+            size_type mask = _M_capacity / _Ctrl::_S_width - 1;
+            size_type group = hash & mask;
+            for (size_type step = 1; ; ++step)
+            {
+                const signed char* ctrl = _M_ctrl.get() + group * _Ctrl::_S_width;
+                std::uint32_t m = _Ctrl::_S_match_free(ctrl);
+                if (m != 0)
+                    return group * _Ctrl::_S_width + _Ctrl::_S_lowest(m);
+                group = (group + step) & mask;
+            }
+        }
+
+        // Place p, known to be absent, into a table with room for it
+        void _M_place(value_type&& p, std::size_t hash) noexcept
+        {
+            size_type i = _M_find_free(hash);
+            if (_M_ctrl[i] == _Ctrl::_S_deleted)
+                --_M_deleted;
+            _M_ctrl[i] = _S_tag(hash);
+            ::new (static_cast<void*>(_M_slots + i)) value_type(std::move(p));
+            ++_M_size;
+        }
+
+        /*
+        * Free slot i. It can become empty again if its group already has an empty slot,
+        * since no probe sequence continues past such a group.
+        */
+        void _M_remove(size_type i) noexcept
+        {
+            _M_slots[i].~value_type();
+            const signed char* ctrl = _M_ctrl.get() + i / _Ctrl::_S_width * _Ctrl::_S_width;
+            if (_Ctrl::_S_match(ctrl, _Ctrl::_S_empty) != 0)
+                _M_ctrl[i] = _Ctrl::_S_empty;
+            else
+            {
+                _M_ctrl[i] = _Ctrl::_S_deleted;
+                ++_M_deleted;
+            }
+            --_M_size;
+        }
+
+        // Keep the load, deleted slots included, below 7/8
+        void _M_reserve_one()
+        {
+            if ((_M_size + _M_deleted + 1) * 8 <= _M_capacity * 7)
+                return;
+            size_type capacity = _M_capacity == 0 ? _Ctrl::_S_width : _M_capacity;
+            while ((_M_size + 1) * 8 > capacity * 7 / 2)
+                capacity *= 2;
+            _M_rehash(capacity);
+        }
+
+        void _M_rehash(size_type capacity)
+        {
+            owning_flat_set other;
+            other._M_ctrl.reset(new signed char[capacity]);
+            other._M_slots = std::allocator<value_type>().allocate(capacity);
+            other._M_capacity = capacity;
+            for (size_type i = 0; i < capacity; ++i)
+                other._M_ctrl[i] = _Ctrl::_S_empty;
+
+            for (size_type i = 0; i < _M_capacity; ++i)
+                if (_M_ctrl[i] >= 0)
+                {
+                    other._M_place(std::move(_M_slots[i]), ptr_hash()(_M_slots[i]));
+                    _M_slots[i].~value_type();
+                    _M_ctrl[i] = _Ctrl::_S_empty;
+                }
+            _M_size = 0;
+            swap(other);
+        }
+
+    public:
+        class const_iterator
+        {
+        private:
+            const owning_flat_set* _M_set;
+            size_type              _M_index;
+
+            friend class owning_flat_set;
+
+            const_iterator(const owning_flat_set* set, size_type index) noexcept
+                : _M_set(set), _M_index(index)
+            {
+                _M_skip();
+            }
+
+            void _M_skip() noexcept
+            {
+                while (_M_index < _M_set->_M_capacity && _M_set->_M_ctrl[_M_index] < 0)
+                    ++_M_index;
+            }
+
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type        = typename owning_flat_set::value_type;
+            using difference_type   = std::ptrdiff_t;
+            using pointer           = const value_type*;
+            using reference         = const value_type&;
+
+            reference operator*() const noexcept
+            {
+                return _M_set->_M_slots[_M_index];
+            }
+
+            pointer operator->() const noexcept
+            {
+                return _M_set->_M_slots + _M_index;
+            }
+
+            const_iterator& operator++() noexcept
+            {
+                ++_M_index;
+                _M_skip();
+                return *this;
+            }
+
+            const_iterator operator++(int) noexcept
+            {
+                const_iterator tmp = *this;
+                ++*this;
+                return tmp;
+            }
+
+            friend bool operator==(const const_iterator& x, const const_iterator& y) noexcept
+            {
+                return x._M_index == y._M_index;
+            }
+
+            friend bool operator!=(const const_iterator& x, const const_iterator& y) noexcept
+            {
+                return x._M_index != y._M_index;
+            }
+        };
+
+        using iterator = const_iterator;
+
+        //  Constructors
+
+        owning_flat_set() noexcept = default;
+
+        owning_flat_set(owning_flat_set&& r) noexcept
+        {
+            swap(r);
+        }
+
+        owning_flat_set& operator=(owning_flat_set&& r) noexcept
+        {
+            owning_flat_set(std::move(r)).swap(*this);
+            return *this;
+        }
+
+        // Destructor, deletes every element
+        ~owning_flat_set()
+        {
+            clear();
+            if (_M_slots != nullptr)
+                std::allocator<value_type>().deallocate(_M_slots, _M_capacity);
+        }
+
+        // Modifiers
+
+        /*
+        * Take ownership of the object of p. If the set already owns that object,
+        * return false and leave p as it is.
+        */
+        bool insert(value_type&& p)
+        {
+            if (!p)
+                return false;
+            std::size_t hash = ptr_hash()(p);
+            if (_M_find(p, hash) != _S_npos)
+                return false;
+            _M_reserve_one();
+            _M_place(std::move(p), hash);
+            return true;
+        }
+
+        /// Construct a new object owned by the set and return it
+        template<typename ... Args>
+        T* emplace(Args&& ... args)
+        {
+            _M_reserve_one();
+            value_type p(new T(std::forward<Args>(args)...));
+            T* raw = p.get();
+            _M_place(std::move(p), ptr_hash()(raw));
+            return raw;
+        }
+
+        /// Delete the object found by key, return the number of objects deleted
+        template<typename Key>
+        size_type erase(const Key& key) noexcept
+        {
+            size_type i = _M_find(key, ptr_hash()(key));
+            if (i == _S_npos)
+                return 0;
+            _M_remove(i);
+            return 1;
+        }
+
+        /// Give up ownership of the object found by key, or return an empty unique_ptr
+        template<typename Key>
+        value_type extract(const Key& key) noexcept
+        {
+            size_type i = _M_find(key, ptr_hash()(key));
+            if (i == _S_npos)
+                return value_type();
+            value_type p(std::move(_M_slots[i]));
+            _M_remove(i);
+            return p;
+        }
+
+        /// Delete every object, the capacity is kept
+        void clear() noexcept
+        {
+            for (size_type i = 0; i < _M_capacity; ++i)
+            {
+                if (_M_ctrl[i] >= 0)
+                    _M_slots[i].~value_type();
+                _M_ctrl[i] = _Ctrl::_S_empty;
+            }
+            _M_size = 0;
+            _M_deleted = 0;
+        }
+
+        /// Make room for n objects without rehashing
+        void reserve(size_type n)
+        {
+            size_type capacity = _Ctrl::_S_width;
+            while (n * 8 > capacity * 7)
+                capacity *= 2;
+            if (capacity > _M_capacity)
+                _M_rehash(capacity);
+        }
+
+        void swap(owning_flat_set& other) noexcept
+        {
+            using std::swap;
+            _M_ctrl.swap(other._M_ctrl);
+            swap(_M_slots, other._M_slots);
+            swap(_M_capacity, other._M_capacity);
+            swap(_M_size, other._M_size);
+            swap(_M_deleted, other._M_deleted);
+        }
+
+        // Lookup
+
+        /// Find by raw pointer, unique_ptr or shared_ptr
+        template<typename Key>
+        const_iterator find(const Key& key) const noexcept
+        {
+            size_type i = _M_find(key, ptr_hash()(key));
+            return i == _S_npos ? end() : const_iterator(this, i);
+        }
+
+        template<typename Key>
+        bool contains(const Key& key) const noexcept
+        {
+            return _M_find(key, ptr_hash()(key)) != _S_npos;
+        }
+
+        // Observers
+
+        const_iterator begin() const noexcept
+        {
+            return const_iterator(this, 0);
+        }
+
+        const_iterator end() const noexcept
+        {
+            return const_iterator(this, _M_capacity);
+        }
+
+        size_type size() const noexcept
+        {
+            return _M_size;
+        }
+
+        bool empty() const noexcept
+        {
+            return _M_size == 0;
+        }
+
+        size_type capacity() const noexcept
+        {
+            return _M_capacity;
+        }
+
+        /// Disable copy from lvalue
+        owning_flat_set(const owning_flat_set&) = delete;
+        owning_flat_set& operator=(const owning_flat_set&) = delete;
+    };
+
+    template<typename T, typename Deleter>
+    inline void swap(owning_flat_set<T, Deleter>& lhs, owning_flat_set<T, Deleter>& rhs) noexcept
+    {
+        lhs.swap(rhs);
+    }
+}
+
+#endif // OWNING_FLAT_SET_H
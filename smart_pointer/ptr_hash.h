@@ -0,0 +1,79 @@
+#ifndef PTR_HASH_H
+#define PTR_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include "shared_ptr.h"
+#include "unique_ptr.h"
+
+namespace sm_ptr
+{
+    // Address held by a raw pointer, unique_ptr or shared_ptr key
+    struct _Ptr_address
+    {
+        template<typename T>
+        static const volatile void* _S_get(T* p) noexcept
+        {
+            return p;
+        }
+
+        template<typename T, typename Deleter>
+        static const volatile void* _S_get(const unique_ptr<T, Deleter>& p) noexcept
+        {
+            return p.get();
+        }
+
+        template<typename T>
+        static const volatile void* _S_get(const shared_ptr<T>& p) noexcept
+        {
+            return p.get();
+        }
+
+        static const volatile void* _S_get(std::nullptr_t) noexcept
+        {
+            return nullptr;
+        }
+    };
+
+    /*
+    * Transparent hash for pointer keys, so a set of owners can be searched with a raw
+    * pointer without building a temporary owner. Keys of different kinds holding the
+    * same address hash the same. Pointers are aligned, so their low bits are mixed
+    * into the whole word instead of being used as they are.
+    */
+    struct ptr_hash
+    {
+        using is_transparent = void;
+
+        template<typename Key>
+        std::size_t operator()(const Key& key) const noexcept
+        {
+            return _S_mix(reinterpret_cast<std::uintptr_t>(_Ptr_address::_S_get(key)));
+        }
+
+        // Finalizer of MurmurHash3, every input bit affects every output bit
+        static std::size_t _S_mix(std::uint64_t x) noexcept
+        {
+            x ^= x >> 33;
+            x *= 0xff51afd7ed558ccdULL;
+            x ^= x >> 33;
+            x *= 0xc4ceb9fe1a85ec53ULL;
+            x ^= x >> 33;
+            return static_cast<std::size_t>(x);
+        }
+    };
+
+    // Transparent equality for pointer keys, compares the addresses they hold
+    struct ptr_equal
+    {
+        using is_transparent = void;
+
+        template<typename Key1, typename Key2>
+        bool operator()(const Key1& x, const Key2& y) const noexcept
+        {
+            return _Ptr_address::_S_get(x) == _Ptr_address::_S_get(y);
+        }
+    };
+}
+
+#endif // PTR_HASH_H
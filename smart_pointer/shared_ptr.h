@@ -1,14 +1,1014 @@
 #ifndef SHARED_PTR_H
 #define SHARED_PTR_H
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <new>
+#include <tuple>
 #include <type_traits>
+#include <utility>
+#include "unique_ptr.h"
 
 namespace sm_ptr
 {
 
 
+// Exception thrown when a shared_ptr is constructed from an expired weak_ptr
+class bad_weak_ptr : public std::exception
+{
+public:
+    const char* what() const noexcept override
+    {
+        return "sm_ptr::bad_weak_ptr";
+    }
+};
+
+
+/*
+* Base of all control blocks.
+* _M_weak_count is the number of weak_ptrs plus one while _M_use_count is not zero,
+* so the block is destroyed by whichever of the last shared_ptr or weak_ptr goes last.
+* There is no vtable: each block type passes the manager function of its own type,
+* picked at compile time, which disposes the object and destroys the block.
+* A null manager means there is nothing to dispose and the block is freed with
+* ::operator delete, so such blocks are released without any indirect call.
+*/
+class _Sp_counted_base
+{
+protected:
+    enum _Op { _S_dispose, _S_destroy };
+
+    // noexcept can't appear in an alias declaration before C++17, managers must not throw
+    using _Manager = void (*)(_Sp_counted_base*, _Op);
+
+    explicit _Sp_counted_base(_Manager manager) noexcept
+        : _M_use_count(1), _M_weak_count(1), _M_manager(manager) { }
+
+    ~_Sp_counted_base() = default;
+
+public:
+    void _M_add_ref_copy() noexcept
+    {
+        _M_use_count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void _M_add_ref_lock()
+    {
+        if (!_M_add_ref_lock_nothrow())
+            throw bad_weak_ptr();
+    }
+
+    /// Increment the use count unless it is already zero
+    bool _M_add_ref_lock_nothrow() noexcept
+    {
+        long count = _M_use_count.load(std::memory_order_relaxed);
+        do
+        {
+            if (count == 0)
+                return false;
+        } while (!_M_use_count.compare_exchange_weak(count, count + 1,
+                                                     std::memory_order_acq_rel,
+                                                     std::memory_order_relaxed));
+        return true;
+    }
+
+    // The manager never changes, reading it once before the decrement lets the compiler
+    // resolve it statically wherever it has seen the block being made
+    void _M_release() noexcept
+    {
+        _Manager manager = _M_manager;
+        if (_M_use_count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            if (manager != nullptr)
+                manager(this, _S_dispose);
+            _M_weak_release(manager);
+        }
+    }
+
+    void _M_weak_add_ref() noexcept
+    {
+        _M_weak_count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void _M_weak_release() noexcept
+    {
+        _M_weak_release(_M_manager);
+    }
+
+    long _M_get_use_count() const noexcept
+    {
+        return _M_use_count.load(std::memory_order_relaxed);
+    }
+
+    // The acquire pairs with the release of other owners' _M_release,
+    // so their accesses to the object happen before ours.
+    bool _M_unique() const noexcept
+    {
+        return _M_use_count.load(std::memory_order_acquire) == 1;
+    }
+
+    _Sp_counted_base(const _Sp_counted_base&) = delete;
+    _Sp_counted_base& operator=(const _Sp_counted_base&) = delete;
+
+private:
+    void _M_weak_release(_Manager manager) noexcept
+    {
+        if (_M_weak_count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            if (manager != nullptr)
+                manager(this, _S_destroy);
+            else
+                ::operator delete(this);
+        }
+    }
+
+    std::atomic<long> _M_use_count;
+    std::atomic<long> _M_weak_count;
+    const _Manager    _M_manager;
+};
+
+
+// Control block for a pointer owned through delete
+template<typename Ptr>
+class _Sp_counted_ptr final : public _Sp_counted_base
+{
+public:
+    explicit _Sp_counted_ptr(Ptr p) noexcept
+        : _Sp_counted_base(&_S_manage), _M_ptr(p) { }
+
+private:
+    static void _S_manage(_Sp_counted_base* base, _Op op) noexcept
+    {
+        auto self = static_cast<_Sp_counted_ptr*>(base);
+        if (op == _S_dispose)
+            delete self->_M_ptr;
+        else
+            delete self;
+    }
+
+    Ptr _M_ptr;
+};
+
+
+/*
+* Control block of make_shared, the object lives in the same allocation.
+* The block is allocated with ::operator new, so when the object is trivially
+* destructible there is nothing to do but free it and no manager is needed.
+* Over-aligned objects take the aligned ::operator new of C++17 and always have
+* a manager, which frees the block with the matching ::operator delete.
+*/
+template<typename Tp>
+class _Sp_counted_ptr_inplace final : public _Sp_counted_base
+{
+    using _Obj = typename std::remove_cv<Tp>::type;
+
+public:
+    template<typename ... Args>
+    explicit _Sp_counted_ptr_inplace(Args&& ... args)
+        : _Sp_counted_base(_S_manager())
+    {
+        ::new (static_cast<void*>(&_M_storage)) _Obj(std::forward<Args>(args)...);
+    }
+
+    /// Allocate and construct a block, the memory is freed if the constructor throws
+    template<typename ... Args>
+    static _Sp_counted_ptr_inplace* _S_create(Args&& ... args)
+    {
+        void* mem = _S_allocate(_Over_aligned());
+        try
+        {
+            return ::new (mem) _Sp_counted_ptr_inplace(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            _S_deallocate(mem, _Over_aligned());
+            throw;
+        }
+    }
+
+    _Obj* _M_ptr() noexcept
+    {
+        return reinterpret_cast<_Obj*>(&_M_storage);
+    }
+
+private:
+#ifdef __cpp_aligned_new
+    using _Over_aligned = std::integral_constant<bool, (alignof(_Obj) > __STDCPP_DEFAULT_NEW_ALIGNMENT__)>;
+
+    static void* _S_allocate(std::true_type)
+    {
+        return ::operator new(sizeof(_Sp_counted_ptr_inplace), std::align_val_t(alignof(_Sp_counted_ptr_inplace)));
+    }
+
+    static void _S_deallocate(void* mem, std::true_type) noexcept
+    {
+        ::operator delete(mem, std::align_val_t(alignof(_Sp_counted_ptr_inplace)));
+    }
+#else
+    static_assert(alignof(_Obj) <= alignof(std::max_align_t),
+                  "make_shared of an over-aligned type needs aligned new (C++17)");
+
+    using _Over_aligned = std::false_type;
+#endif
+
+    static void* _S_allocate(std::false_type)
+    {
+        return ::operator new(sizeof(_Sp_counted_ptr_inplace));
+    }
+
+    static void _S_deallocate(void* mem, std::false_type) noexcept
+    {
+        ::operator delete(mem);
+    }
+
+    // The null manager frees with the plain ::operator delete, so over-aligned blocks need one
+    static constexpr _Manager _S_manager() noexcept
+    {
+        return std::is_trivially_destructible<_Obj>::value && !_Over_aligned::value ? nullptr : &_S_manage;
+    }
+
+    static void _S_manage(_Sp_counted_base* base, _Op op) noexcept
+    {
+        auto self = static_cast<_Sp_counted_ptr_inplace*>(base);
+        if (op == _S_dispose)
+            self->_M_ptr()->~_Obj();
+        else
+            _S_deallocate(self, _Over_aligned());
+    }
+
+    typename std::aligned_storage<sizeof(_Obj), alignof(_Obj)>::type _M_storage;
+};
+
+
+/*
+* Control block for a pointer owned through a custom deleter.
+* The deleter and the allocator are stored inline in the block, in a tuple
+* like unique_ptr so empty ones take no space, and the block is allocated
+* once through the allocator. The manager knows the deleter and allocator
+* types, so disposing calls the deleter directly.
+*/
+template<typename Ptr, typename Deleter, typename Alloc>
+class _Sp_counted_deleter final : public _Sp_counted_base
+{
+    using _Alloc        = typename std::allocator_traits<Alloc>::template rebind_alloc<_Sp_counted_deleter>;
+    using _Alloc_traits = std::allocator_traits<_Alloc>;
+
+public:
+    template<typename D>
+    _Sp_counted_deleter(Ptr p, D&& d, const Alloc& a) noexcept
+        : _Sp_counted_base(&_S_manage), _M_impl(p, std::forward<D>(d), a) { }
+
+    /// Allocate and construct a block, @p d is left untouched if the allocation throws
+    template<typename D>
+    static _Sp_counted_deleter* _S_create(Ptr p, D&& d, const Alloc& a)
+    {
+        _Alloc alloc(a);
+        auto mem = _Alloc_traits::allocate(alloc, 1);
+        return ::new (static_cast<void*>(std::addressof(*mem)))
+            _Sp_counted_deleter(p, std::forward<D>(d), a);
+    }
+
+private:
+    static void _S_manage(_Sp_counted_base* base, _Op op) noexcept
+    {
+        auto self = static_cast<_Sp_counted_deleter*>(base);
+        if (op == _S_dispose)
+        {
+            std::get<1>(self->_M_impl)(std::get<0>(self->_M_impl));
+            return;
+        }
+        _Alloc alloc(std::get<2>(self->_M_impl));
+        auto mem = std::pointer_traits<typename _Alloc_traits::pointer>::pointer_to(*self);
+        self->~_Sp_counted_deleter();
+        _Alloc_traits::deallocate(alloc, mem, 1);
+    }
+
+    std::tuple<Ptr, Deleter, Alloc> _M_impl;
+};
+
+
+struct _Sp_make_shared_tag { };
+
+struct _Sp_borrow_tag { };
+
+
+/*
+* Deleter of the unique_ptrs returned by make_unique_shareable.
+* It refers to the control block allocated next to the object, so that converting
+* the unique_ptr to a shared_ptr adopts that block instead of allocating one.
+* Only a pointer into the object of the block is released through the block,
+* any other pointer, e.g. one given to reset(), is deleted like with default_delete.
+* Don't call release() on such a unique_ptr: the object lives inside the block,
+* so the released pointer can't be deleted and the block is leaked.
+*/
+class shareable_delete
+{
+public:
+    constexpr shareable_delete() noexcept
+        : _M_pi(nullptr), _M_end(nullptr) { }
+
+    /// Refer to block @p pi whose object ends at @p end
+    shareable_delete(_Sp_counted_base* pi, const volatile void* end) noexcept
+        : _M_pi(pi), _M_end(end) { }
+
+    shareable_delete(shareable_delete&& d) noexcept
+        : _M_pi(d._M_pi), _M_end(d._M_end)
+    {
+        d._M_pi = nullptr;
+    }
+
+    shareable_delete& operator=(shareable_delete&& d) noexcept
+    {
+        std::swap(_M_pi, d._M_pi);
+        std::swap(_M_end, d._M_end);
+        return *this;
+    }
+
+    template<typename Tp>
+    void operator()(Tp* ptr) noexcept
+    {
+        static_assert(sizeof(Tp) > 0,
+                      "can't delete pointer to incomplete type");
+        if (_M_owns(ptr))
+            _M_take()->_M_release();
+        else
+            _S_delete(ptr);
+    }
+
+    /// Return true if @p ptr points into the object of the block.
+    /// A base class subobject may start after the object, so this is a range check.
+    bool _M_owns(const volatile void* ptr) const noexcept
+    {
+        auto p = reinterpret_cast<std::uintptr_t>(ptr);
+        return _M_pi != nullptr
+            && p > reinterpret_cast<std::uintptr_t>(_M_pi)
+            && p < reinterpret_cast<std::uintptr_t>(_M_end);
+    }
+
+    /// Hand the reserved control block over to the caller
+    _Sp_counted_base* _M_take() noexcept
+    {
+        _Sp_counted_base* pi = _M_pi;
+        _M_pi = nullptr;
+        return pi;
+    }
+
+    shareable_delete(const shareable_delete&) = delete;
+    shareable_delete& operator=(const shareable_delete&) = delete;
+
+private:
+    // Kept out of line: inlined, GCC sees a pointer into a block on the path it can't
+    // rule out and warns that delete frees a non-heap object (-Wfree-nonheap-object)
+    template<typename Tp>
+#ifdef __GNUC__
+    __attribute__((noinline))
+#endif
+    static void _S_delete(Tp* ptr) noexcept
+    {
+        delete ptr;
+    }
+
+    _Sp_counted_base*   _M_pi;
+    const volatile void* _M_end;
+};
+
+template<typename T>
+using unique_shareable_ptr = unique_ptr<T, shareable_delete>;
+
+class __weak_count;
+
+
+// Owning handle to a control block, one use count
+class __shared_count
+{
+public:
+    constexpr __shared_count() noexcept
+        : _M_pi(nullptr) { }
+
+    template<typename Ptr>
+    explicit __shared_count(Ptr p)
+        : _M_pi(nullptr)
+    {
+        try
+        {
+            _M_pi = new _Sp_counted_ptr<Ptr>(p);
+        }
+        catch (...)
+        {
+            delete p;
+            throw;
+        }
+    }
+
+    // Own p through d, the deleter is called on p if the control block cannot be allocated
+    template<typename Ptr, typename Deleter, typename Alloc, typename
+             = std::enable_if_t<!std::is_same<Deleter, _Sp_make_shared_tag>::value>>
+    __shared_count(Ptr p, Deleter d, Alloc a)
+        : _M_pi(nullptr)
+    {
+        try
+        {
+            _M_pi = _Sp_counted_deleter<Ptr, Deleter, Alloc>::_S_create(p, std::move(d), a);
+        }
+        catch (...)
+        {
+            d(p);
+            throw;
+        }
+    }
+
+    // Adopt the control block reserved by make_unique_shareable, no allocation.
+    // A pointer which is not the object of the block gets a block of its own.
+    template<typename Tp>
+    explicit __shared_count(unique_ptr<Tp, shareable_delete>&& r)
+        : _M_pi(nullptr)
+    {
+        if (r.get() == nullptr)
+            return;
+        if (r.get_deleter()._M_owns(r.get()))
+            _M_pi = r.get_deleter()._M_take();
+        else
+            _M_pi = new _Sp_counted_ptr<Tp*>(r.get());
+        r.release();
+    }
+
+    // Take over the pointer and the deleter of r, r keeps them if the allocation throws
+    template<typename Tp, typename Deleter>
+    explicit __shared_count(unique_ptr<Tp, Deleter>&& r)
+        : _M_pi(nullptr)
+    {
+        using _Ptr = typename unique_ptr<Tp, Deleter>::pointer;
+        using _Del = typename std::conditional<std::is_reference<Deleter>::value,
+                        std::reference_wrapper<typename std::remove_reference<Deleter>::type>,
+                        Deleter>::type;
+
+        if (r.get() == _Ptr())
+            return;
+        _M_pi = _Sp_counted_deleter<_Ptr, _Del, std::allocator<void>>::_S_create(
+                    r.get(), std::forward<Deleter>(r.get_deleter()), std::allocator<void>());
+        r.release();
+    }
+
+    // Take one more use count on a block which still has owners, used by shared_ref
+    __shared_count(_Sp_counted_base* pi, _Sp_borrow_tag) noexcept
+        : _M_pi(pi)
+    {
+        if (_M_pi != nullptr)
+            _M_pi->_M_add_ref_copy();
+    }
+
+    /// Allocate the control block and the object together, and point @p p at the object
+    template<typename Tp, typename ... Args>
+    __shared_count(Tp*& p, _Sp_make_shared_tag, Args&& ... args)
+    {
+        auto pi = _Sp_counted_ptr_inplace<Tp>::_S_create(std::forward<Args>(args)...);
+        p = pi->_M_ptr();
+        _M_pi = pi;
+    }
+
+    // Throw bad_weak_ptr when r has expired
+    explicit __shared_count(const __weak_count& r);
+
+    // Leave *this empty when r has expired
+    __shared_count(const __weak_count& r, std::nothrow_t) noexcept;
+
+    ~__shared_count() noexcept
+    {
+        if (_M_pi != nullptr)
+            _M_pi->_M_release();
+    }
+
+    __shared_count(const __shared_count& r) noexcept
+        : _M_pi(r._M_pi)
+    {
+        if (_M_pi != nullptr)
+            _M_pi->_M_add_ref_copy();
+    }
+
+    __shared_count& operator=(const __shared_count& r) noexcept
+    {
+        _Sp_counted_base* tmp = r._M_pi;
+        if (tmp != _M_pi)
+        {
+            if (tmp != nullptr)
+                tmp->_M_add_ref_copy();
+            if (_M_pi != nullptr)
+                _M_pi->_M_release();
+            _M_pi = tmp;
+        }
+        return *this;
+    }
+
+    void _M_swap(__shared_count& r) noexcept
+    {
+        std::swap(_M_pi, r._M_pi);
+    }
+
+    long _M_get_use_count() const noexcept
+    {
+        return _M_pi != nullptr ? _M_pi->_M_get_use_count() : 0;
+    }
+
+    bool _M_unique() const noexcept
+    {
+        return _M_pi != nullptr && _M_pi->_M_unique();
+    }
+
+    // The control block identifies the owner
+    _Sp_counted_base* _M_get_owner() const noexcept
+    {
+        return _M_pi;
+    }
+
+private:
+    friend class __weak_count;
+
+    _Sp_counted_base* _M_pi;
+};
+
+
+// Non-owning handle to a control block, one weak count
+class __weak_count
+{
+public:
+    constexpr __weak_count() noexcept
+        : _M_pi(nullptr) { }
+
+    __weak_count(const __shared_count& r) noexcept
+        : _M_pi(r._M_pi)
+    {
+        if (_M_pi != nullptr)
+            _M_pi->_M_weak_add_ref();
+    }
+
+    __weak_count(const __weak_count& r) noexcept
+        : _M_pi(r._M_pi)
+    {
+        if (_M_pi != nullptr)
+            _M_pi->_M_weak_add_ref();
+    }
+
+    __weak_count(__weak_count&& r) noexcept
+        : _M_pi(r._M_pi)
+    {
+        r._M_pi = nullptr;
+    }
+
+    ~__weak_count() noexcept
+    {
+        if (_M_pi != nullptr)
+            _M_pi->_M_weak_release();
+    }
+
+    __weak_count& operator=(const __shared_count& r) noexcept
+    {
+        _Sp_counted_base* tmp = r._M_pi;
+        if (tmp != nullptr)
+            tmp->_M_weak_add_ref();
+        if (_M_pi != nullptr)
+            _M_pi->_M_weak_release();
+        _M_pi = tmp;
+        return *this;
+    }
+
+    __weak_count& operator=(const __weak_count& r) noexcept
+    {
+        _Sp_counted_base* tmp = r._M_pi;
+        if (tmp != nullptr)
+            tmp->_M_weak_add_ref();
+        if (_M_pi != nullptr)
+            _M_pi->_M_weak_release();
+        _M_pi = tmp;
+        return *this;
+    }
+
+    __weak_count& operator=(__weak_count&& r) noexcept
+    {
+        if (_M_pi != nullptr)
+            _M_pi->_M_weak_release();
+        _M_pi = r._M_pi;
+        r._M_pi = nullptr;
+        return *this;
+    }
+
+    void _M_swap(__weak_count& r) noexcept
+    {
+        std::swap(_M_pi, r._M_pi);
+    }
+
+    long _M_get_use_count() const noexcept
+    {
+        return _M_pi != nullptr ? _M_pi->_M_get_use_count() : 0;
+    }
+
+    _Sp_counted_base* _M_get_owner() const noexcept
+    {
+        return _M_pi;
+    }
+
+private:
+    friend class __shared_count;
+
+    _Sp_counted_base* _M_pi;
+};
+
+
+inline __shared_count::__shared_count(const __weak_count& r)
+    : _M_pi(r._M_pi)
+{
+    if (_M_pi != nullptr)
+        _M_pi->_M_add_ref_lock();
+    else
+        throw bad_weak_ptr();
+}
+
+inline __shared_count::__shared_count(const __weak_count& r, std::nothrow_t) noexcept
+    : _M_pi(r._M_pi)
+{
+    if (_M_pi != nullptr && !_M_pi->_M_add_ref_lock_nothrow())
+        _M_pi = nullptr;
+}
+
+
+template<typename T>
+class __weak_ptr;
+
+struct _Sp_borrow_access;
+
+
+template<typename T>
+class __shared_ptr
+{
+    template<typename Ptr>
+    using _Convertible = std::enable_if_t<std::is_convertible<Ptr, T*>::value>;
+
+public:
+    using element_type = T;
+
+    constexpr __shared_ptr() noexcept
+        : _M_ptr(nullptr), _M_refcount() { }
+
+    template<typename Tp, typename = _Convertible<Tp*>>
+    explicit __shared_ptr(Tp* p)
+        : _M_ptr(p), _M_refcount(p) { }
+
+    template<typename Tp, typename Deleter, typename = _Convertible<Tp*>>
+    __shared_ptr(Tp* p, Deleter d)
+        : _M_ptr(p), _M_refcount(p, std::move(d), std::allocator<void>()) { }
+
+    template<typename Deleter>
+    __shared_ptr(std::nullptr_t p, Deleter d)
+        : _M_ptr(nullptr), _M_refcount(p, std::move(d), std::allocator<void>()) { }
+
+    template<typename Tp, typename Deleter, typename Alloc, typename = _Convertible<Tp*>>
+    __shared_ptr(Tp* p, Deleter d, Alloc a)
+        : _M_ptr(p), _M_refcount(p, std::move(d), std::move(a)) { }
+
+    template<typename Deleter, typename Alloc>
+    __shared_ptr(std::nullptr_t p, Deleter d, Alloc a)
+        : _M_ptr(nullptr), _M_refcount(p, std::move(d), std::move(a)) { }
+
+    /// Aliasing constructor: share ownership with r but point at p
+    template<typename Tp>
+    __shared_ptr(const __shared_ptr<Tp>& r, T* p) noexcept
+        : _M_ptr(p), _M_refcount(r._M_refcount) { }
+
+    __shared_ptr(const __shared_ptr&) noexcept = default;
+    __shared_ptr& operator=(const __shared_ptr&) noexcept = default;
+
+    template<typename Tp, typename = _Convertible<Tp*>>
+    __shared_ptr(const __shared_ptr<Tp>& r) noexcept
+        : _M_ptr(r._M_ptr), _M_refcount(r._M_refcount) { }
+
+    __shared_ptr(__shared_ptr&& r) noexcept
+        : _M_ptr(r._M_ptr), _M_refcount()
+    {
+        _M_refcount._M_swap(r._M_refcount);
+        r._M_ptr = nullptr;
+    }
+
+    template<typename Tp, typename = _Convertible<Tp*>>
+    __shared_ptr(__shared_ptr<Tp>&& r) noexcept
+        : _M_ptr(r._M_ptr), _M_refcount()
+    {
+        _M_refcount._M_swap(r._M_refcount);
+        r._M_ptr = nullptr;
+    }
+
+    template<typename Tp, typename = _Convertible<Tp*>>
+    explicit __shared_ptr(const __weak_ptr<Tp>& r)
+        : _M_refcount(r._M_refcount)
+    {
+        _M_ptr = r._M_ptr;
+    }
+
+    template<typename Tp, typename Deleter, typename
+             = _Convertible<typename unique_ptr<Tp, Deleter>::pointer>>
+    __shared_ptr(unique_ptr<Tp, Deleter>&& r)
+        : _M_ptr(r.get()), _M_refcount(std::move(r)) { }
+
+    // Used by weak_ptr::lock(), leaves *this empty when r has expired
+    __shared_ptr(const __weak_ptr<T>& r, std::nothrow_t) noexcept
+        : _M_refcount(r._M_refcount, std::nothrow)
+    {
+        _M_ptr = _M_refcount._M_get_use_count() ? r._M_ptr : nullptr;
+    }
+
+    // Used by make_shared
+    template<typename ... Args>
+    __shared_ptr(_Sp_make_shared_tag tag, Args&& ... args)
+        : _M_ptr(), _M_refcount(_M_ptr, tag, std::forward<Args>(args)...) { }
+
+    // Used by shared_ref, share the ownership of a block which still has owners
+    __shared_ptr(T* p, _Sp_counted_base* pi, _Sp_borrow_tag tag) noexcept
+        : _M_ptr(p), _M_refcount(pi, tag) { }
+
+    template<typename Tp>
+    __shared_ptr& operator=(const __shared_ptr<Tp>& r) noexcept
+    {
+        _M_ptr = r._M_ptr;
+        _M_refcount = r._M_refcount;
+        return *this;
+    }
+
+    __shared_ptr& operator=(__shared_ptr&& r) noexcept
+    {
+        __shared_ptr(std::move(r)).swap(*this);
+        return *this;
+    }
+
+    template<typename Tp>
+    __shared_ptr& operator=(__shared_ptr<Tp>&& r) noexcept
+    {
+        __shared_ptr(std::move(r)).swap(*this);
+        return *this;
+    }
+
+    template<typename Tp, typename Deleter>
+    __shared_ptr& operator=(unique_ptr<Tp, Deleter>&& r)
+    {
+        __shared_ptr(std::move(r)).swap(*this);
+        return *this;
+    }
+
+    // Observers
+
+    /// Dereference the stored pointer
+    typename std::add_lvalue_reference<T>::type operator*() const noexcept
+    {
+        return *_M_ptr;
+    }
+
+    /// Return the stored pointer
+    T* operator->() const noexcept
+    {
+        return _M_ptr;
+    }
+
+    /// Return the stored pointer
+    T* get() const noexcept
+    {
+        return _M_ptr;
+    }
+
+    /// Return true if the stored pointer is not null
+    explicit operator bool() const noexcept
+    {
+        return _M_ptr != nullptr;
+    }
+
+    /// Return true if *this is the only owner, a single acquire load
+    bool unique() const noexcept
+    {
+        return _M_refcount._M_unique();
+    }
+
+    /// Return the number of shared_ptrs sharing ownership with *this
+    long use_count() const noexcept
+    {
+        return _M_refcount._M_get_use_count();
+    }
+
+    // Ownership-based observers, equal for all shared_ptrs and weak_ptrs sharing a
+    // control block, and stable after the object has expired
+
+    /// Return true if the control block of *this orders before that of r
+    template<typename Tp>
+    bool owner_before(const __shared_ptr<Tp>& r) const noexcept
+    {
+        return std::less<_Sp_counted_base*>()(_M_refcount._M_get_owner(), r._M_refcount._M_get_owner());
+    }
+
+    template<typename Tp>
+    bool owner_before(const __weak_ptr<Tp>& r) const noexcept
+    {
+        return std::less<_Sp_counted_base*>()(_M_refcount._M_get_owner(), r._M_refcount._M_get_owner());
+    }
+
+    /// Return true if *this and r share a control block, or are both empty
+    template<typename Tp>
+    bool owner_equal(const __shared_ptr<Tp>& r) const noexcept
+    {
+        return _M_refcount._M_get_owner() == r._M_refcount._M_get_owner();
+    }
+
+    template<typename Tp>
+    bool owner_equal(const __weak_ptr<Tp>& r) const noexcept
+    {
+        return _M_refcount._M_get_owner() == r._M_refcount._M_get_owner();
+    }
+
+    /// Return a hash of the control block
+    std::size_t owner_hash() const noexcept
+    {
+        return std::hash<_Sp_counted_base*>()(_M_refcount._M_get_owner());
+    }
+
+    // Modifiers
+
+    /// Release ownership of the managed object
+    void reset() noexcept
+    {
+        __shared_ptr().swap(*this);
+    }
+
+    /// Replace the managed object by p
+    template<typename Tp, typename = _Convertible<Tp*>>
+    void reset(Tp* p)
+    {
+        __shared_ptr(p).swap(*this);
+    }
+
+    /// Replace the managed object by p, released through d
+    template<typename Tp, typename Deleter, typename = _Convertible<Tp*>>
+    void reset(Tp* p, Deleter d)
+    {
+        __shared_ptr(p, std::move(d)).swap(*this);
+    }
+
+    /// Replace the managed object by p, released through d, allocating the control block with a
+    template<typename Tp, typename Deleter, typename Alloc, typename = _Convertible<Tp*>>
+    void reset(Tp* p, Deleter d, Alloc a)
+    {
+        __shared_ptr(p, std::move(d), std::move(a)).swap(*this);
+    }
+
+    /// Exchange the stored pointer and the ownership with another object
+    void swap(__shared_ptr& other) noexcept
+    {
+        std::swap(_M_ptr, other._M_ptr);
+        _M_refcount._M_swap(other._M_refcount);
+    }
+
+protected:
+    template<typename Tp> friend class __shared_ptr;
+    template<typename Tp> friend class __weak_ptr;
+    friend struct _Sp_borrow_access;
+
+    T*             _M_ptr;
+    __shared_count _M_refcount;
+};
+
+
+template<typename T>
+class __weak_ptr
+{
+    template<typename Ptr>
+    using _Convertible = std::enable_if_t<std::is_convertible<Ptr, T*>::value>;
+
+public:
+    using element_type = T;
+
+    constexpr __weak_ptr() noexcept
+        : _M_ptr(nullptr), _M_refcount() { }
+
+    __weak_ptr(const __weak_ptr&) noexcept = default;
+    __weak_ptr& operator=(const __weak_ptr&) noexcept = default;
+
+    /*
+    * The pointer of r may dangle once r has expired, and converting it to a base
+    * may read the object (virtual bases), so go through lock() in that case.
+    */
+    template<typename Tp, typename = _Convertible<Tp*>>
+    __weak_ptr(const __weak_ptr<Tp>& r) noexcept
+        : _M_refcount(r._M_refcount)
+    {
+        _M_ptr = r.lock().get();
+    }
+
+    template<typename Tp, typename = _Convertible<Tp*>>
+    __weak_ptr(const __shared_ptr<Tp>& r) noexcept
+        : _M_ptr(r._M_ptr), _M_refcount(r._M_refcount) { }
+
+    __weak_ptr(__weak_ptr&& r) noexcept
+        : _M_ptr(r._M_ptr), _M_refcount(std::move(r._M_refcount))
+    {
+        r._M_ptr = nullptr;
+    }
+
+    __weak_ptr& operator=(__weak_ptr&& r) noexcept
+    {
+        _M_ptr = r._M_ptr;
+        _M_refcount = std::move(r._M_refcount);
+        r._M_ptr = nullptr;
+        return *this;
+    }
+
+    template<typename Tp>
+    __weak_ptr& operator=(const __weak_ptr<Tp>& r) noexcept
+    {
+        _M_ptr = r.lock().get();
+        _M_refcount = r._M_refcount;
+        return *this;
+    }
+
+    template<typename Tp>
+    __weak_ptr& operator=(const __shared_ptr<Tp>& r) noexcept
+    {
+        _M_ptr = r._M_ptr;
+        _M_refcount = r._M_refcount;
+        return *this;
+    }
+
+    /// Return a shared_ptr owning the object, or an empty one if it has expired
+    __shared_ptr<T> lock() const noexcept
+    {
+        return __shared_ptr<T>(*this, std::nothrow);
+    }
+
+    /// Return the number of shared_ptrs owning the object
+    long use_count() const noexcept
+    {
+        return _M_refcount._M_get_use_count();
+    }
+
+    /// Return true if the object has been released
+    bool expired() const noexcept
+    {
+        return _M_refcount._M_get_use_count() == 0;
+    }
+
+    // Ownership-based observers, equal for all shared_ptrs and weak_ptrs sharing a
+    // control block, and stable after the object has expired
+
+    /// Return true if the control block of *this orders before that of r
+    template<typename Tp>
+    bool owner_before(const __shared_ptr<Tp>& r) const noexcept
+    {
+        return std::less<_Sp_counted_base*>()(_M_refcount._M_get_owner(), r._M_refcount._M_get_owner());
+    }
+
+    template<typename Tp>
+    bool owner_before(const __weak_ptr<Tp>& r) const noexcept
+    {
+        return std::less<_Sp_counted_base*>()(_M_refcount._M_get_owner(), r._M_refcount._M_get_owner());
+    }
+
+    /// Return true if *this and r share a control block, or are both empty
+    template<typename Tp>
+    bool owner_equal(const __shared_ptr<Tp>& r) const noexcept
+    {
+        return _M_refcount._M_get_owner() == r._M_refcount._M_get_owner();
+    }
+
+    template<typename Tp>
+    bool owner_equal(const __weak_ptr<Tp>& r) const noexcept
+    {
+        return _M_refcount._M_get_owner() == r._M_refcount._M_get_owner();
+    }
+
+    /// Return a hash of the control block
+    std::size_t owner_hash() const noexcept
+    {
+        return std::hash<_Sp_counted_base*>()(_M_refcount._M_get_owner());
+    }
+
+    void reset() noexcept
+    {
+        __weak_ptr().swap(*this);
+    }
+
+    void swap(__weak_ptr& other) noexcept
+    {
+        std::swap(_M_ptr, other._M_ptr);
+        _M_refcount._M_swap(other._M_refcount);
+    }
+
+protected:
+    template<typename Tp> friend class __shared_ptr;
+    template<typename Tp> friend class __weak_ptr;
+
+    T*           _M_ptr;
+    __weak_count _M_refcount;
+};
+
+
 template<typename T>
-class __shared_ptr;
+class weak_ptr;
 
 
 template<typename T>
@@ -16,33 +1016,50 @@ class shared_ptr: public __shared_ptr<T>
 {
     template<typename Ptr>
     using _Convertible = std::enable_if_t<std::is_convertible<Ptr, T*>::value>;
+
+    template<typename Tp, typename ... Args>
+    friend shared_ptr<Tp> make_shared(Args&& ... args);
+
+    template<typename Tp> friend class weak_ptr;
+    friend struct _Sp_borrow_access;
+
+    template<typename ... Args>
+    shared_ptr(_Sp_make_shared_tag tag, Args&& ... args)
+        : __shared_ptr<T>(tag, std::forward<Args>(args)...) { }
+
+    shared_ptr(T* p, _Sp_counted_base* pi, _Sp_borrow_tag tag) noexcept
+        : __shared_ptr<T>(p, pi, tag) { }
+
+    shared_ptr(const weak_ptr<T>& r, std::nothrow_t) noexcept
+        : __shared_ptr<T>(r, std::nothrow) { }
+
 public:
     using element_type = T;
 
     constexpr shared_ptr() noexcept
-        : __shared_ptr() { }
+        : __shared_ptr<T>() { }
 
     shared_ptr(const shared_ptr&) noexcept = default;
 
-    template<typename Tp>
-    shared_ptr(Tp* p)
+    template<typename Tp, typename = _Convertible<Tp*>>
+    explicit shared_ptr(Tp* p)
         : __shared_ptr<T>(p) { }
 
-    template<typename Tp, typename Deleter>
+    template<typename Tp, typename Deleter, typename = _Convertible<Tp*>>
     shared_ptr(Tp *p, Deleter d)
-        : __shared_ptr<T>(p, d) { }
+        : __shared_ptr<T>(p, std::move(d)) { }
 
     template<typename Deleter>
     shared_ptr(std::nullptr_t p, Deleter d)
-        : __shared_ptr<T>(p, d) { }
+        : __shared_ptr<T>(p, std::move(d)) { }
 
-    template<typename Tp, typename Deleter, typename Alloc>
+    template<typename Tp, typename Deleter, typename Alloc, typename = _Convertible<Tp*>>
     shared_ptr(Tp* p, Deleter d, Alloc a)
-        : __shared_ptr<T>(p, d, std::move(a)) { }
+        : __shared_ptr<T>(p, std::move(d), std::move(a)) { }
 
     template<typename Deleter, typename Alloc>
     shared_ptr(std::nullptr_t p, Deleter d, Alloc a)
-        : __shared_ptr(p, d, std::move(a)) { }
+        : __shared_ptr<T>(p, std::move(d), std::move(a)) { }
 
     template<typename Tp>
     shared_ptr(const shared_ptr<Tp>& r, T* p) noexcept
@@ -59,8 +1076,8 @@ public:
     shared_ptr(shared_ptr<Tp>&& r) noexcept
         : __shared_ptr<T>(std::move(r)) { }
 
-    template<typename Tp>
-    shared_ptr(const weak_ptr<Tp>& r)
+    template<typename Tp, typename = _Convertible<Tp*>>
+    explicit shared_ptr(const weak_ptr<Tp>& r)
         : __shared_ptr<T>(r) { }
 
     template<typename Tp, typename Deleter, typename
@@ -69,37 +1086,225 @@ public:
         : __shared_ptr<T>(std::move(r)) { }
 
     constexpr shared_ptr(std::nullptr_t) noexcept
-        : shared_ptr() { };
-
-    
+        : shared_ptr() { }
 
     shared_ptr& operator=(const shared_ptr&) noexcept = default;
 
     template<typename Tp>
     shared_ptr& operator=(const shared_ptr<Tp>& r) noexcept
     {
-        this->__shared_ptr<Tp>::operator=(r);
+        this->__shared_ptr<T>::operator=(r);
         return *this;
     }
 
     shared_ptr& operator=(shared_ptr&& r) noexcept
     {
-        this->__shared_ptr<Tp>::operator=(std::move(r));
+        this->__shared_ptr<T>::operator=(std::move(r));
+        return *this;
+    }
+
+    template<typename Tp>
+    shared_ptr& operator=(shared_ptr<Tp>&& r) noexcept
+    {
+        this->__shared_ptr<T>::operator=(std::move(r));
         return *this;
     }
 
     template<typename Tp, typename Deleter>
-    shared_ptr& operator=(std::unique_ptr<Tp, Deleter>&& r)
+    shared_ptr& operator=(sm_ptr::unique_ptr<Tp, Deleter>&& r)
     {
-        this->__shared_ptr<Tp>::operator=(std::move(r));
+        this->__shared_ptr<T>::operator=(std::move(r));
         return *this;
     }
+};
 
-private:
-    T* obj_ptr;
-    
+
+/*
+* What shared_ref and weak_key_map need of the internals of shared_ptr.
+* shared_ref lives in an inline namespace which depends on its checking mode,
+* so it can't be named as a friend here.
+*/
+struct _Sp_borrow_access
+{
+    template<typename T>
+    static T* _S_ptr(const __shared_ptr<T>& r) noexcept
+    {
+        return r._M_ptr;
+    }
+
+    template<typename T>
+    static _Sp_counted_base* _S_owner(const __shared_ptr<T>& r) noexcept
+    {
+        return r._M_refcount._M_get_owner();
+    }
+
+    /// Share the ownership of block @p pi, which must still have owners
+    template<typename T>
+    static shared_ptr<T> _S_share(T* p, _Sp_counted_base* pi) noexcept
+    {
+        return shared_ptr<T>(p, pi, _Sp_borrow_tag());
+    }
+};
+
+
+template<typename T>
+class weak_ptr: public __weak_ptr<T>
+{
+    template<typename Ptr>
+    using _Convertible = std::enable_if_t<std::is_convertible<Ptr, T*>::value>;
+
+public:
+    constexpr weak_ptr() noexcept
+        : __weak_ptr<T>() { }
+
+    weak_ptr(const weak_ptr&) noexcept = default;
+    weak_ptr& operator=(const weak_ptr&) noexcept = default;
+
+    weak_ptr(weak_ptr&&) noexcept = default;
+    weak_ptr& operator=(weak_ptr&&) noexcept = default;
+
+    template<typename Tp, typename = _Convertible<Tp*>>
+    weak_ptr(const shared_ptr<Tp>& r) noexcept
+        : __weak_ptr<T>(r) { }
+
+    template<typename Tp, typename = _Convertible<Tp*>>
+    weak_ptr(const weak_ptr<Tp>& r) noexcept
+        : __weak_ptr<T>(r) { }
+
+    template<typename Tp>
+    weak_ptr& operator=(const weak_ptr<Tp>& r) noexcept
+    {
+        this->__weak_ptr<T>::operator=(r);
+        return *this;
+    }
+
+    template<typename Tp>
+    weak_ptr& operator=(const shared_ptr<Tp>& r) noexcept
+    {
+        this->__weak_ptr<T>::operator=(r);
+        return *this;
+    }
+
+    /// Return a shared_ptr owning the object, or an empty one if it has expired
+    shared_ptr<T> lock() const noexcept
+    {
+        return shared_ptr<T>(*this, std::nothrow);
+    }
+};
+
+
+/// Allocate the object and its control block together
+template<typename T, typename ... Args>
+inline shared_ptr<T> make_shared(Args&& ... args)
+{
+    return shared_ptr<T>(_Sp_make_shared_tag(), std::forward<Args>(args)...);
+}
+
+/*
+* Construct the object in a block laid out like that of make_shared but return it as
+* a unique_ptr. Converting the result to a shared_ptr reuses the block and does not allocate.
+*/
+template<typename T, typename ... Args>
+inline unique_shareable_ptr<T> make_unique_shareable(Args&& ... args)
+{
+    static_assert(!std::is_array<T>::value,
+                  "make_unique_shareable of an array type");
+    auto pi = _Sp_counted_ptr_inplace<T>::_S_create(std::forward<Args>(args)...);
+    return unique_shareable_ptr<T>(pi->_M_ptr(), shareable_delete(pi, pi->_M_ptr() + 1));
+}
+
+template<typename T>
+inline void swap(shared_ptr<T>& lhs, shared_ptr<T>& rhs) noexcept
+{
+    lhs.swap(rhs);
+}
+
+template<typename T>
+inline void swap(weak_ptr<T>& lhs, weak_ptr<T>& rhs) noexcept
+{
+    lhs.swap(rhs);
+}
+
+template<typename T1, typename T2>
+inline bool operator==(const shared_ptr<T1>& x, const shared_ptr<T2>& y) noexcept
+{
+    return x.get() == y.get();
+}
+
+template<typename T1, typename T2>
+inline bool operator!=(const shared_ptr<T1>& x, const shared_ptr<T2>& y) noexcept
+{
+    return x.get() != y.get();
+}
+
+template<typename T1, typename T2>
+inline bool operator<(const shared_ptr<T1>& x, const shared_ptr<T2>& y) noexcept
+{
+    using CT = typename std::common_type<T1*, T2*>::type;
+    return std::less<CT>()(x.get(), y.get());
+}
+
+template<typename T>
+inline bool operator==(const shared_ptr<T>& x, std::nullptr_t) noexcept
+{
+    return !x;
+}
+
+template<typename T>
+inline bool operator==(std::nullptr_t, const shared_ptr<T>& x) noexcept
+{
+    return !x;
+}
+
+template<typename T>
+inline bool operator!=(const shared_ptr<T>& x, std::nullptr_t) noexcept
+{
+    return (bool)x;
+}
+
+template<typename T>
+inline bool operator!=(std::nullptr_t, const shared_ptr<T>& x) noexcept
+{
+    return (bool)x;
+}
+
+
+// Ownership-based ordering of shared_ptrs and weak_ptrs, in any combination
+struct owner_less
+{
+    using is_transparent = void;
+
+    template<typename Ptr1, typename Ptr2>
+    bool operator()(const Ptr1& x, const Ptr2& y) const noexcept
+    {
+        return x.owner_before(y);
+    }
+};
+
+// Ownership-based hash of shared_ptrs and weak_ptrs
+struct owner_hash
+{
+    using is_transparent = void;
+
+    template<typename Ptr>
+    std::size_t operator()(const Ptr& p) const noexcept
+    {
+        return p.owner_hash();
+    }
+};
+
+// Ownership-based equality of shared_ptrs and weak_ptrs, in any combination
+struct owner_equal
+{
+    using is_transparent = void;
+
+    template<typename Ptr1, typename Ptr2>
+    bool operator()(const Ptr1& x, const Ptr2& y) const noexcept
+    {
+        return x.owner_equal(y);
+    }
 };
 
 }
 
-#endif
\ No newline at end of file
+#endif
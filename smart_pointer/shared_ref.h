@@ -0,0 +1,180 @@
+#ifndef SHARED_REF_H
+#define SHARED_REF_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <type_traits>
+#include "shared_ptr.h"
+
+// Borrow checks are on unless NDEBUG is defined, define SM_PTR_CHECK_BORROWS to 0 or 1 to choose
+#ifndef SM_PTR_CHECK_BORROWS
+#ifdef NDEBUG
+#define SM_PTR_CHECK_BORROWS 0
+#else
+#define SM_PTR_CHECK_BORROWS 1
+#endif
+#endif
+
+namespace sm_ptr
+{
+// The checked and unchecked shared_ref differ in layout and copying, so each has its own
+// inline namespace: translation units built with different modes fail to link together
+// instead of passing one kind of shared_ref where the other is expected.
+#if SM_PTR_CHECK_BORROWS
+inline namespace __checked_borrows
+#else
+inline namespace __unchecked_borrows
+#endif
+{
+    /*
+    * Non-owning borrow of an object owned by shared_ptrs, to pass down a call stack
+    * instead of copying the shared_ptr, which costs two atomic operations per call.
+    * It keeps the stored pointer and the control block of its owner, so it allows
+    * the same conversions and aliasing as shared_ptr, and a callee which needs to
+    * retain the object calls to_shared() to take a use count on that block.
+    * The owner must outlive the borrow, like for a reference, and must not be empty,
+    * so borrowing from a temporary shared_ptr does not compile.
+    * Without checks it is two trivially copied pointers passed in registers;
+    * with SM_PTR_CHECK_BORROWS each borrow holds a weak count, so that using or
+    * destroying a borrow after its owner is gone aborts instead of reading freed memory.
+    */
+    template<typename T>
+    class shared_ref
+    {
+    private:
+        template<typename Ptr>
+        using _Convertible = typename std::enable_if<std::is_convertible<Ptr, T*>::value>::type;
+
+        template<typename Tp> friend class shared_ref;
+
+        T*                _M_ptr;
+        _Sp_counted_base* _M_pi;
+
+        shared_ref(T* p, _Sp_counted_base* pi) noexcept
+            : _M_ptr(p), _M_pi(pi)
+        {
+            _M_check_borrow();
+        }
+
+#if SM_PTR_CHECK_BORROWS
+        [[noreturn]] static void _S_fail(const char* what) noexcept
+        {
+            std::fprintf(stderr, "sm_ptr::shared_ref: %s\n", what);
+            std::abort();
+        }
+
+        void _M_check_borrow() const noexcept
+        {
+            if (_M_pi == nullptr)
+                _S_fail("borrowing from an empty shared_ptr");
+            _M_pi->_M_weak_add_ref();
+        }
+
+        void _M_check_owner() const noexcept
+        {
+            if (_M_pi->_M_get_use_count() == 0)
+                _S_fail("borrow outlived its owner");
+        }
+#else
+        void _M_check_borrow() const noexcept { }
+        void _M_check_owner() const noexcept { }
+#endif
+
+    public:
+        using element_type = T;
+
+        // Constructors
+
+        template<typename Tp, typename = _Convertible<Tp*>>
+        shared_ref(const __shared_ptr<Tp>& r) noexcept
+            : shared_ref(_Sp_borrow_access::_S_ptr(r), _Sp_borrow_access::_S_owner(r)) { }
+
+        /// Aliasing constructor: borrow the ownership of r but point at p
+        template<typename Tp>
+        shared_ref(const __shared_ptr<Tp>& r, T* p) noexcept
+            : shared_ref(p, _Sp_borrow_access::_S_owner(r)) { }
+
+        // A temporary owner is destroyed before the borrow is used
+        template<typename Tp, typename = _Convertible<Tp*>>
+        shared_ref(__shared_ptr<Tp>&& r) = delete;
+
+        template<typename Tp>
+        shared_ref(__shared_ptr<Tp>&& r, T* p) = delete;
+
+        template<typename Tp, typename = _Convertible<Tp*>>
+        shared_ref(const shared_ref<Tp>& r) noexcept
+            : shared_ref(r._M_ptr, r._M_pi) { }
+
+#if SM_PTR_CHECK_BORROWS
+        shared_ref(const shared_ref& r) noexcept
+            : shared_ref(r._M_ptr, r._M_pi) { }
+
+        shared_ref& operator=(const shared_ref& r) noexcept
+        {
+            r._M_check_borrow();
+            _M_check_owner();
+            _M_pi->_M_weak_release();
+            _M_ptr = r._M_ptr;
+            _M_pi = r._M_pi;
+            return *this;
+        }
+
+        // Destructor, the owner must still be alive
+        ~shared_ref()
+        {
+            _M_check_owner();
+            _M_pi->_M_weak_release();
+        }
+#else
+        shared_ref(const shared_ref&) noexcept = default;
+        shared_ref& operator=(const shared_ref&) noexcept = default;
+#endif
+
+        // Observers
+
+        T* get() const noexcept
+        {
+            _M_check_owner();
+            return _M_ptr;
+        }
+
+        typename std::add_lvalue_reference<T>::type operator*() const noexcept
+        {
+            return *get();
+        }
+
+        T* operator->() const noexcept
+        {
+            return get();
+        }
+
+        long use_count() const noexcept
+        {
+            return _M_pi->_M_get_use_count();
+        }
+
+        // Conversions
+
+        /// Share the ownership of the object, for callees which keep it beyond the call
+        shared_ptr<T> to_shared() const noexcept
+        {
+            _M_check_owner();
+            return _Sp_borrow_access::_S_share(_M_ptr, _M_pi);
+        }
+    };
+
+    template<typename T1, typename T2>
+    inline bool operator==(const shared_ref<T1>& x, const shared_ref<T2>& y) noexcept
+    {
+        return x.get() == y.get();
+    }
+
+    template<typename T1, typename T2>
+    inline bool operator!=(const shared_ref<T1>& x, const shared_ref<T2>& y) noexcept
+    {
+        return x.get() != y.get();
+    }
+}
+}
+
+#endif // SHARED_REF_H
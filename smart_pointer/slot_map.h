@@ -0,0 +1,264 @@
+#ifndef SLOT_MAP_H
+#define SLOT_MAP_H
+
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "unique_ptr.h"
+
+namespace sm_ptr
+{
+    /*
+    * Container storing its objects contiguously and handing out 64-bit generational handles.
+    * A handle holds a slot index and the generation of the slot when the object was inserted;
+    * erasing bumps the generation, so stale handles stop resolving instead of dangling.
+    * Lookup is a bounds check and a generation compare, erase moves the last object into
+    * the hole so the objects stay dense, which changes their order and addresses.
+    */
+    template<typename T>
+    class slot_map
+    {
+    public:
+        // Weak reference to an object of the slot_map, the default handle refers to nothing
+        class handle
+        {
+        private:
+            std::uint64_t _M_value;
+
+            friend class slot_map;
+
+            handle(std::uint32_t slot, std::uint32_t generation) noexcept
+                : _M_value(std::uint64_t(generation) << 32 | slot) { }
+
+            std::uint32_t _M_slot() const noexcept
+            {
+                return static_cast<std::uint32_t>(_M_value);
+            }
+
+            std::uint32_t _M_generation() const noexcept
+            {
+                return static_cast<std::uint32_t>(_M_value >> 32);
+            }
+
+        public:
+            constexpr handle() noexcept
+                : _M_value(0) { }
+
+            /// Return the handle as one integer, e.g. to store it outside of C++
+            std::uint64_t value() const noexcept
+            {
+                return _M_value;
+            }
+
+            static handle from_value(std::uint64_t value) noexcept
+            {
+                handle h;
+                h._M_value = value;
+                return h;
+            }
+
+            friend bool operator==(handle x, handle y) noexcept
+            {
+                return x._M_value == y._M_value;
+            }
+
+            friend bool operator!=(handle x, handle y) noexcept
+            {
+                return x._M_value != y._M_value;
+            }
+        };
+
+        using value_type     = T;
+        using size_type      = std::size_t;
+        using iterator       = typename std::vector<T>::iterator;
+        using const_iterator = typename std::vector<T>::const_iterator;
+
+    private:
+        static constexpr std::uint32_t _S_no_slot = std::numeric_limits<std::uint32_t>::max();
+
+        // Generations start at 1 so that the default handle never resolves
+        struct _Slot
+        {
+            std::uint32_t _M_index;         // dense index while live, next free slot while free
+            std::uint32_t _M_generation;
+        };
+
+        std::vector<T>             _M_data;
+        std::vector<std::uint32_t> _M_slot_of;     // slot of each dense object
+        std::vector<_Slot>         _M_slots;
+        std::uint32_t              _M_free = _S_no_slot;
+
+        // Return the slot of h if h is live, _S_no_slot otherwise.
+        // A forged handle or one of another slot_map may match the generation of a free slot,
+        // whose index is a free list link, so the slot must also be the owner of its index.
+        std::uint32_t _M_find(handle h) const noexcept
+        {
+            std::uint32_t slot = h._M_slot();
+            if (slot >= _M_slots.size() || _M_slots[slot]._M_generation != h._M_generation())
+                return _S_no_slot;
+            std::uint32_t index = _M_slots[slot]._M_index;
+            if (index < _M_slot_of.size() && _M_slot_of[index] == slot)
+                return slot;
+            return _S_no_slot;
+        }
+
+        // Swap-and-pop the object of a live slot
+        void _M_remove(std::uint32_t slot)
+        {
+            std::uint32_t index = _M_slots[slot]._M_index;
+            std::uint32_t last = static_cast<std::uint32_t>(_M_data.size() - 1);
+            if (index != last)
+            {
+                _M_data[index] = std::move(_M_data[last]);
+                _M_slot_of[index] = _M_slot_of[last];
+                _M_slots[_M_slot_of[index]]._M_index = index;
+            }
+            _M_data.pop_back();
+            _M_slot_of.pop_back();
+
+            _Slot& s = _M_slots[slot];
+            if (++s._M_generation == 0)
+                s._M_generation = 1;
+            s._M_index = _M_free;
+            _M_free = slot;
+        }
+
+    public:
+        // Modifiers
+
+        template<typename ... Args>
+        handle emplace(Args&& ... args)
+        {
+            // A new slot goes on the free list first, so a throwing constructor leaves it there
+            if (_M_free == _S_no_slot)
+            {
+                if (_M_slots.size() == _S_no_slot)
+                    throw std::length_error("slot_map: too many slots");
+                _M_slots.push_back(_Slot{_S_no_slot, 1});
+                _M_free = static_cast<std::uint32_t>(_M_slots.size() - 1);
+            }
+
+            std::uint32_t slot = _M_free;
+            _M_slot_of.push_back(slot);
+            try
+            {
+                _M_data.emplace_back(std::forward<Args>(args)...);
+            }
+            catch (...)
+            {
+                _M_slot_of.pop_back();
+                throw;
+            }
+
+            _Slot& s = _M_slots[slot];
+            _M_free = s._M_index;
+            s._M_index = static_cast<std::uint32_t>(_M_data.size() - 1);
+            return handle(slot, s._M_generation);
+        }
+
+        handle insert(const T& value)
+        {
+            return emplace(value);
+        }
+
+        handle insert(T&& value)
+        {
+            return emplace(std::move(value));
+        }
+
+        /// Move the object owned by p into the map, p is left empty.
+        /// An empty p inserts nothing and returns the default handle.
+        template<typename Deleter>
+        handle insert(unique_ptr<T, Deleter>&& p)
+        {
+            if (!p)
+                return handle();
+            handle h = emplace(std::move(*p));
+            p.reset();
+            return h;
+        }
+
+        /// Remove the object of h, return false if h is stale
+        bool erase(handle h)
+        {
+            std::uint32_t slot = _M_find(h);
+            if (slot == _S_no_slot)
+                return false;
+            _M_remove(slot);
+            return true;
+        }
+
+        /// Move the object of h out of the map into a unique_ptr, which is empty if h is stale
+        unique_ptr<T> extract(handle h)
+        {
+            std::uint32_t slot = _M_find(h);
+            if (slot == _S_no_slot)
+                return unique_ptr<T>();
+            auto p = sm_ptr::make_unique<T>(std::move(_M_data[_M_slots[slot]._M_index]));
+            _M_remove(slot);
+            return p;
+        }
+
+        void clear() noexcept
+        {
+            for (std::uint32_t slot : _M_slot_of)
+            {
+                _Slot& s = _M_slots[slot];
+                if (++s._M_generation == 0)
+                    s._M_generation = 1;
+                s._M_index = _M_free;
+                _M_free = slot;
+            }
+            _M_data.clear();
+            _M_slot_of.clear();
+        }
+
+        void reserve(size_type n)
+        {
+            _M_data.reserve(n);
+            _M_slot_of.reserve(n);
+            _M_slots.reserve(n);
+        }
+
+        // Lookup
+
+        /// Return the object of h, or null if h is stale
+        T* get(handle h) noexcept
+        {
+            std::uint32_t slot = _M_find(h);
+            return slot != _S_no_slot ? &_M_data[_M_slots[slot]._M_index] : nullptr;
+        }
+
+        const T* get(handle h) const noexcept
+        {
+            std::uint32_t slot = _M_find(h);
+            return slot != _S_no_slot ? &_M_data[_M_slots[slot]._M_index] : nullptr;
+        }
+
+        bool contains(handle h) const noexcept
+        {
+            return _M_find(h) != _S_no_slot;
+        }
+
+        // Dense iteration, in no particular order
+
+        iterator begin() noexcept { return _M_data.begin(); }
+        iterator end() noexcept { return _M_data.end(); }
+        const_iterator begin() const noexcept { return _M_data.begin(); }
+        const_iterator end() const noexcept { return _M_data.end(); }
+
+        size_type size() const noexcept
+        {
+            return _M_data.size();
+        }
+
+        bool empty() const noexcept
+        {
+            return _M_data.empty();
+        }
+    };
+}
+
+#endif // SLOT_MAP_H
@@ -0,0 +1,66 @@
+#include "cow_ptr.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cassert>
+
+// It is tests for cow_ptr
+struct Header {
+    Header(std::string _name) : name(std::move(_name)) { }
+    Header(const Header& h) : name(h.name) { ++copies; std::cout << "Header copy ctor\n"; }
+    std::string name;
+    static int copies;
+};
+
+int Header::copies = 0;
+
+int main()
+{
+    // Tests for constructors
+    {
+        sm_ptr::cow_ptr<Header> cp1;
+        sm_ptr::cow_ptr<Header> cp2(nullptr);
+        assert(!cp1 && !cp2);
+        assert(cp1.get_mutable() == nullptr);
+
+        sm_ptr::cow_ptr<Header> cp3(new Header("host"));
+        assert(cp3 && cp3->name == "host" && cp3.unique());
+    }
+
+    // Copies share the object until one of them is written
+    {
+        auto cp1 = sm_ptr::make_cow<Header>("host");
+        auto cp2 = cp1;
+        auto cp3 = cp1;
+        assert(cp1.get() == cp2.get() && cp1.use_count() == 3);
+
+        // Reads never copy
+        assert((*cp2).name == "host" && cp3->name == "host");
+        assert(Header::copies == 0);
+
+        // The first write of a shared object clones it
+        cp2.get_mutable()->name = "accept";
+        assert(Header::copies == 1);
+        assert(cp1->name == "host" && cp2->name == "accept");
+        assert(cp2.unique() && cp1.use_count() == 2);
+
+        // Later writes of an unshared object do not
+        cp2.get_mutable()->name = "accept-encoding";
+        assert(Header::copies == 1);
+
+        cp3 = nullptr;
+        assert(cp1.unique());
+        cp1.get_mutable()->name = "content-type";
+        assert(Header::copies == 1);
+    }
+
+    // Tests for swap()
+    {
+        auto cp1 = sm_ptr::make_cow<std::vector<int>>(3, 1);
+        auto cp2 = sm_ptr::make_cow<std::vector<int>>(5, 2);
+        sm_ptr::swap(cp1, cp2);
+        assert(cp1->size() == 5 && cp2->size() == 3);
+        cp1.reset();
+        assert(!cp1);
+    }
+}
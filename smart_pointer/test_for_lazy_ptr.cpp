@@ -0,0 +1,147 @@
+#include "lazy_ptr.h"
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <cassert>
+
+// It is tests for lazy_ptr
+static std::atomic<int> constructed(0);
+static std::atomic<int> destroyed(0);
+
+struct Subsystem {
+    Subsystem() : name("default") { ++constructed; }
+    Subsystem(std::string _name) : name(std::move(_name)) { ++constructed; }
+    ~Subsystem() { ++destroyed; }
+    std::string name;
+};
+
+int main()
+{
+    // Tests for construction on first access
+    {
+        constructed = destroyed = 0;
+        {
+            sm_ptr::lazy_ptr<Subsystem> lazy;
+            assert(!lazy.constructed() && constructed == 0);
+            assert(lazy->name == "default" && lazy.constructed() && constructed == 1);
+            assert(lazy.get() == &*lazy && constructed == 1);
+
+            // Const access constructs too
+            const sm_ptr::lazy_ptr<Subsystem> clazy;
+            assert((*clazy).name == "default" && constructed == 2);
+        }
+        assert(destroyed == 2);
+
+        // A lazy_ptr never used constructs nothing
+        {
+            sm_ptr::lazy_ptr<Subsystem> unused;
+        }
+        assert(constructed == 2 && destroyed == 2);
+    }
+
+    // Tests for factories
+    {
+        int calls = 0;
+        auto lazy = sm_ptr::make_lazy<Subsystem>([&calls] {
+            ++calls;
+            return sm_ptr::make_unique<Subsystem>("network");
+        });
+        assert(calls == 0);
+        assert(lazy->name == "network" && lazy->name == "network" && calls == 1);
+
+        // A throwing factory leaves the lazy_ptr empty, the next access tries again
+        int attempts = 0;
+        auto flaky = sm_ptr::make_lazy<Subsystem>([&attempts] {
+            if (++attempts == 1)
+                throw std::string("not yet");
+            return sm_ptr::make_unique<Subsystem>("flaky");
+        });
+        bool thrown = false;
+        try
+        {
+            flaky.get();
+        }
+        catch (const std::string& e)
+        {
+            std::cout << e << std::endl;
+            thrown = true;
+        }
+        assert(thrown && !flaky.constructed());
+        assert(flaky->name == "flaky" && attempts == 2);
+    }
+
+    // Tests for concurrent first access, the factory runs once
+    {
+        std::atomic<int> calls(0);
+        auto lazy = sm_ptr::make_lazy<Subsystem>([&calls] {
+            ++calls;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            return sm_ptr::make_unique<Subsystem>("shared");
+        });
+
+        std::vector<std::thread> threads;
+        std::vector<Subsystem*> seen(8);
+        for (int i = 0; i < 8; ++i)
+            threads.emplace_back([&lazy, &seen, i] { seen[i] = lazy.get(); });
+        for (auto& t : threads)
+            t.join();
+
+        assert(calls == 1);
+        for (Subsystem* p : seen)
+            assert(p == lazy.get() && p->name == "shared");
+    }
+
+    // Threads blocked on a factory which throws wake up and try again
+    {
+        std::atomic<int> calls(0);
+        auto flaky = sm_ptr::make_lazy<Subsystem>([&calls] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            if (calls++ == 0)
+                throw std::runtime_error("first attempt fails");
+            return sm_ptr::make_unique<Subsystem>("retried");
+        });
+
+        std::atomic<int> failures(0);
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 8; ++i)
+            threads.emplace_back([&flaky, &failures] {
+                try
+                {
+                    assert(flaky->name == "retried");
+                }
+                catch (const std::runtime_error&)
+                {
+                    ++failures;
+                }
+            });
+        for (auto& t : threads)
+            t.join();
+
+        assert(calls == 2 && failures == 1);
+    }
+
+    // Tests for extract(), reset() and move
+    {
+        constructed = destroyed = 0;
+        sm_ptr::lazy_ptr<Subsystem> lazy;
+
+        // extract() constructs if needed and hands the object over
+        sm_ptr::unique_ptr<Subsystem> up = lazy.extract();
+        assert(up && up->name == "default" && !lazy.constructed() && constructed == 1);
+
+        lazy.reset(new Subsystem("given"));
+        assert(lazy.constructed() && lazy->name == "given");
+        lazy.reset();
+        assert(!lazy.constructed() && destroyed == 1);
+
+        lazy.get();
+        sm_ptr::lazy_ptr<Subsystem> moved(std::move(lazy));
+        assert(moved.constructed() && !lazy.constructed());
+        lazy = std::move(moved);
+        assert(lazy.constructed() && !moved.constructed());
+        std::cout << "lazy_ptr constructed " << constructed << " subsystems\n";
+    }
+}
@@ -0,0 +1,112 @@
+#include "mmap_arena.h"
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <cstdio>
+#include <unistd.h>
+
+// It is tests for mmap_arena
+struct Entry {
+    Entry(int _key) : key(_key) { }
+    int key;
+    sm_ptr::arena_unique_ptr<Entry> next;
+};
+
+struct Index {
+    long count = 0;
+    sm_ptr::arena_unique_ptr<Entry> head;
+};
+
+static long count_entries(const Index& index)
+{
+    long n = 0;
+    for (const Entry* e = index.head.get().get(); e != nullptr; e = e->next.get().get())
+        ++n;
+    return n;
+}
+
+int main()
+{
+    std::string path = "/tmp/sm_ptr_arena_" + std::to_string(::getpid());
+    ::unlink(path.c_str());
+
+    // Build a list owned by unique_ptrs inside the arena
+    {
+        sm_ptr::mmap_arena arena(path.c_str(), 1 << 20);
+        assert(arena.created() && arena.root<Index>() == nullptr);
+
+        auto index = sm_ptr::make_arena_unique<Index>(arena);
+        for (int i = 0; i < 100; ++i)
+        {
+            auto e = sm_ptr::make_arena_unique<Entry>(arena, i);
+            e->next = std::move(index->head);
+            index->head = std::move(e);
+            ++index->count;
+        }
+        arena.set_root(index.release().get());
+        arena.sync();
+    }
+
+    // Reopen it twice, so at least one mapping is at another address
+    {
+        sm_ptr::mmap_arena first(path.c_str(), 0);
+        sm_ptr::mmap_arena second(path.c_str(), 0);
+        assert(!first.created() && !second.created());
+
+        Index* a = first.root<Index>();
+        Index* b = second.root<Index>();
+        assert(a != b);
+        assert(a->count == 100 && count_entries(*a) == 100);
+        assert(b->count == 100 && count_entries(*b) == 100);
+        assert(a->head->key == 99 && b->head->next->key == 98);
+
+        // Pointers resolve inside their own mapping
+        assert(reinterpret_cast<char*>(b->head.get().get()) > reinterpret_cast<char*>(b));
+        assert(reinterpret_cast<char*>(b->head.get().get()) < reinterpret_cast<char*>(b) + (1 << 20));
+    }
+
+    // Freed blocks are reused
+    {
+        sm_ptr::mmap_arena arena(path.c_str(), 0);
+        Index* index = arena.root<Index>();
+        std::size_t used = arena.used();
+
+        // The deleters stored in the file release into the current mapping
+        auto first = std::move(index->head);
+        index->head = std::move(first->next);
+        first.reset();
+        --index->count;
+
+        auto e = sm_ptr::make_arena_unique<Entry>(arena, 1000);
+        assert(arena.used() == used);
+        e->next = std::move(index->head);
+        index->head = std::move(e);
+        assert(count_entries(*index) == 100 && index->head->key == 1000);
+        std::cout << "arena uses " << arena.used() << " bytes\n";
+    }
+
+    // A file that is not an arena is rejected
+    {
+        std::string other = path + "_bad";
+        {
+            FILE* f = std::fopen(other.c_str(), "w");
+            for (int i = 0; i < 4096; ++i)
+                std::fputc('x', f);
+            std::fclose(f);
+        }
+        bool thrown = false;
+        try
+        {
+            sm_ptr::mmap_arena arena(other.c_str(), 0);
+        }
+        catch (const std::exception& e)
+        {
+            std::cout << e.what() << std::endl;
+            thrown = true;
+        }
+        assert(thrown);
+        ::unlink(other.c_str());
+    }
+
+    ::unlink(path.c_str());
+}
@@ -0,0 +1,139 @@
+#include "object_pool.h"
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cassert>
+
+// It is tests for object_pool
+struct Message {
+    Message() { ++constructed; }
+    ~Message() { ++destroyed; }
+    void clear() { body.clear(); id = 0; }
+    std::string body;
+    int id = 0;
+    static std::atomic<int> constructed;
+    static std::atomic<int> destroyed;
+};
+
+std::atomic<int> Message::constructed(0);
+std::atomic<int> Message::destroyed(0);
+
+struct Counter {
+    int val = 0;
+};
+
+// clear() returning a reference is still found
+struct Buffer {
+    Buffer& clear() { data.clear(); return *this; }
+    std::vector<int> data;
+};
+
+int main()
+{
+    {
+        sm_ptr::object_pool<Message> pool;
+
+        // Returned objects are reset and reused instead of destroyed
+        Message* first;
+        {
+            auto m = pool.acquire();
+            m->body.assign(1000, 'x');
+            m->id = 7;
+            first = m.get();
+        }
+        assert(Message::constructed == 1 && Message::destroyed == 0);
+        {
+            auto m = pool.acquire();
+            assert(m.get() == first);
+            assert(m->body.empty() && m->id == 0);
+            // The reserved buffer is kept
+            assert(m->body.capacity() >= 1000);
+
+            auto m2 = pool.acquire();
+            assert(m2.get() != first && Message::constructed == 2);
+        }
+
+        // Shared objects go back to the pool once the last owner is gone
+        {
+            auto sp = pool.acquire_shared();
+            auto sp2 = sp;
+            sp->id = 3;
+            assert(sp2->id == 3 && sp.use_count() == 2);
+        }
+        assert(Message::constructed == 2 && Message::destroyed == 0);
+
+        pool.reserve(10);
+        assert(Message::constructed == 12);
+    }
+    // The pool destroys every object it constructed
+    assert(Message::destroyed == Message::constructed);
+
+    // Types without clear() are returned as they are
+    {
+        sm_ptr::object_pool<Counter> pool;
+        {
+            auto c = pool.acquire();
+            c->val = 5;
+        }
+        assert(pool.acquire()->val == 5);
+    }
+
+    {
+        sm_ptr::object_pool<Buffer> pool;
+        pool.acquire()->data.push_back(1);
+        assert(pool.acquire()->data.empty());
+    }
+
+    // Objects released on other threads come back through the overflow list
+    {
+        sm_ptr::object_pool<Message> pool(4);
+        int before = Message::constructed;
+        std::vector<sm_ptr::object_pool<Message>::pointer> batch;
+        for (int i = 0; i < 16; ++i)
+            batch.push_back(pool.acquire());
+
+        std::thread t([&batch] { batch.clear(); });
+        t.join();
+
+        for (int i = 0; i < 16; ++i)
+            batch.push_back(pool.acquire());
+        assert(Message::constructed == before + 16);
+        batch.clear();
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; ++i)
+            threads.emplace_back([&pool] {
+                for (int j = 0; j < 1000; ++j)
+                {
+                    auto m = pool.acquire();
+                    auto m2 = pool.acquire();
+                    m->id = j;
+                }
+            });
+        for (auto& t : threads)
+            t.join();
+    }
+    assert(Message::destroyed == Message::constructed);
+
+    // Without a local cache every object released goes to the overflow list
+    {
+        sm_ptr::object_pool<Message> pool(0);
+        int before = Message::constructed;
+        pool.acquire();
+        std::thread t([&pool] { pool.acquire(); });
+        t.join();
+        assert(Message::constructed == before + 1);
+    }
+    assert(Message::destroyed == Message::constructed);
+
+    // A new pool does not take over the cache of a destroyed one
+    {
+        sm_ptr::object_pool<Message> pool;
+        auto m = pool.acquire();
+        assert(m->id == 0);
+    }
+    assert(Message::destroyed == Message::constructed);
+    std::cout << "object_pool constructed " << Message::constructed << " messages\n";
+}
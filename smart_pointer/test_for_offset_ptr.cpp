@@ -0,0 +1,87 @@
+#include "offset_ptr.h"
+#include "unique_ptr.h"
+#include <iostream>
+#include <cassert>
+#include <cstring>
+#include <type_traits>
+#include <unordered_set>
+
+// It is tests for offset_ptr and unique_ptr with a fancy pointer type
+struct Node {
+    int val;
+    sm_ptr::offset_ptr<Node> next;
+};
+
+// Deleter defining its own pointer type
+template<typename T>
+struct OffsetDelete {
+    using pointer = sm_ptr::offset_ptr<T>;
+    void operator()(pointer p) const { std::cout << "OffsetDelete\n"; delete p.get(); }
+};
+
+template<typename T>
+struct OffsetDelete<T[]> {
+    using pointer = sm_ptr::offset_ptr<T>;
+    void operator()(pointer p) const { std::cout << "OffsetDelete[]\n"; delete [] p.get(); }
+};
+
+int main()
+{
+    // Tests for offset_ptr
+    {
+        sm_ptr::offset_ptr<int> p1;
+        sm_ptr::offset_ptr<int> p2(nullptr);
+        assert(!p1 && p1 == nullptr && p1 == p2);
+
+        int x = 1;
+        sm_ptr::offset_ptr<int> p3(&x);
+        sm_ptr::offset_ptr<int> p4(p3);
+        assert(p3.get() == &x && p4.get() == &x && *p4 == 1);
+        p1 = p4;
+        assert(p1 == p3);
+        p1 = nullptr;
+        assert(!p1);
+
+        Node n{2, nullptr};
+        sm_ptr::offset_ptr<const Node> pn(&n);
+        assert(pn->val == 2);
+    }
+
+    // A structure pointing into itself stays valid when its bytes are moved
+    {
+        Node nodes[2];
+        nodes[0].val = 1;
+        nodes[0].next = &nodes[1];
+        nodes[1].val = 2;
+        nodes[1].next = nullptr;
+
+        alignas(Node) unsigned char copy[sizeof(nodes)];
+        std::memcpy(copy, nodes, sizeof(nodes));
+        Node* moved = reinterpret_cast<Node*>(copy);
+        assert(moved[0].next.get() == &moved[1]);
+        assert(moved[0].next->val == 2 && !moved[1].next);
+    }
+
+    // unique_ptr takes its pointer type from the deleter
+    {
+        static_assert(std::is_same<sm_ptr::unique_ptr<int, OffsetDelete<int>>::pointer,
+                                   sm_ptr::offset_ptr<int>>::value, "pointer of single object");
+        static_assert(std::is_same<sm_ptr::unique_ptr<int[], OffsetDelete<int[]>>::pointer,
+                                   sm_ptr::offset_ptr<int>>::value, "pointer of array");
+
+        sm_ptr::unique_ptr<Node, OffsetDelete<Node>> up(new Node{3, nullptr});
+        assert(up && up->val == 3 && (*up).val == 3);
+        sm_ptr::unique_ptr<Node, OffsetDelete<Node>> up2(std::move(up));
+        assert(!up && up2 != nullptr);
+
+        std::unordered_set<sm_ptr::unique_ptr<Node, OffsetDelete<Node>>, sm_ptr::unique_ptr_hash> set;
+        set.insert(std::move(up2));
+        assert(set.size() == 1);
+
+        sm_ptr::unique_ptr<int[], OffsetDelete<int[]>> arr(new int[4]());
+        arr[2] = 5;
+        assert(arr[2] == 5);
+        arr.reset();
+        assert(!arr);
+    }
+}
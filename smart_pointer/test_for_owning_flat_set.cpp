@@ -0,0 +1,107 @@
+#include "owning_flat_set.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <cassert>
+
+// It is tests for ptr_hash, ptr_equal and owning_flat_set
+struct Foo {
+    Foo(int _val) : val(_val) { ++alive; }
+    ~Foo() { --alive; }
+    int val;
+    static int alive;
+};
+
+int Foo::alive = 0;
+
+int main()
+{
+    // Tests for ptr_hash and ptr_equal
+    {
+        sm_ptr::unique_ptr<Foo> up(new Foo(1));
+        sm_ptr::shared_ptr<Foo> sp(up.get(), [](Foo*) { });
+        Foo* raw = up.get();
+
+        sm_ptr::ptr_hash hash;
+        sm_ptr::ptr_equal equal;
+        assert(hash(up) == hash(raw) && hash(sp) == hash(raw));
+        assert(hash(static_cast<const Foo*>(raw)) == hash(raw));
+        assert(equal(up, raw) && equal(raw, sp) && equal(sp, up));
+        assert(!equal(up, nullptr));
+
+        // Usable as the functors of a standard set
+        std::unordered_set<sm_ptr::unique_ptr<Foo>, sm_ptr::ptr_hash, sm_ptr::ptr_equal> set;
+        set.insert(std::move(up));
+        assert(set.size() == 1);
+    }
+    assert(Foo::alive == 0);
+
+    // Tests for insertion and heterogeneous lookup
+    {
+        sm_ptr::owning_flat_set<Foo> set;
+        assert(set.empty() && !set.contains(static_cast<Foo*>(nullptr)));
+
+        sm_ptr::unique_ptr<Foo> up(new Foo(1));
+        Foo* raw = up.get();
+        assert(set.insert(std::move(up)) && !up);
+        assert(set.size() == 1 && set.contains(raw));
+        assert(set.find(raw)->get() == raw && (*set.find(raw))->val == 1);
+
+        // Inserting an object that is already owned leaves the argument alone
+        sm_ptr::unique_ptr<Foo> dup(raw);
+        assert(!set.insert(std::move(dup)) && dup.get() == raw);
+        dup.release();
+
+        Foo* f2 = set.emplace(2);
+        assert(set.contains(f2) && set.size() == 2);
+
+        Foo other(3);
+        assert(!set.contains(&other) && set.find(&other) == set.end());
+    }
+    assert(Foo::alive == 0);
+
+    // Growth, erase and extract
+    {
+        sm_ptr::owning_flat_set<Foo> set;
+        std::vector<Foo*> objects;
+        for (int i = 0; i < 1000; ++i)
+            objects.push_back(set.emplace(i));
+        assert(set.size() == 1000 && Foo::alive == 1000);
+        assert(set.capacity() * 7 >= set.size() * 8);
+
+        for (int i = 0; i < 1000; ++i)
+            assert(set.contains(objects[i]) && (*set.find(objects[i]))->val == i);
+
+        for (int i = 0; i < 1000; i += 2)
+            assert(set.erase(objects[i]) == 1);
+        assert(set.size() == 500 && Foo::alive == 500);
+        assert(set.erase(objects[0]) == 0);
+        for (int i = 0; i < 1000; ++i)
+            assert(set.contains(objects[i]) == (i % 2 == 1));
+
+        sm_ptr::unique_ptr<Foo> out = set.extract(objects[1]);
+        assert(out.get() == objects[1] && !set.contains(objects[1]));
+        assert(!set.extract(objects[1]));
+
+        // Erased slots are reused
+        for (int i = 0; i < 2000; ++i)
+            set.erase(set.emplace(i));
+        assert(set.size() == 499);
+
+        long sum = 0;
+        for (auto& p : set)
+            sum += p->val;
+        long expected = 0;
+        for (int i = 3; i < 1000; i += 2)
+            expected += i;
+        assert(sum == expected);
+
+        sm_ptr::owning_flat_set<Foo> moved(std::move(set));
+        assert(moved.size() == 499 && set.empty());
+        moved.clear();
+        assert(moved.empty() && Foo::alive == 1);
+    }
+    assert(Foo::alive == 0);
+    std::cout << "owning_flat_set tests passed\n";
+}
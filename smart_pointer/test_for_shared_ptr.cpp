@@ -1,7 +1,325 @@
-#include <memory>
-#include <array>
+#include "shared_ptr.h"
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+// It is tests for shared_ptr and weak_ptr
+struct Foo {
+    Foo() { std::cout << "Foo ctor\n"; }
+    Foo(int _val) : val(_val) { std::cout << "Foo(int) ctor\n"; }
+    virtual ~Foo() { std::cout << "~Foo dtor\n"; }
+    int val = 0;
+};
+
+struct Bar : Foo {
+    Bar() { std::cout << "Bar ctor\n"; }
+    ~Bar() { std::cout << "~Bar dtor\n"; }
+};
+
+// Counts every allocation of the test
+static int allocations = 0;
+
+__attribute__((noinline)) void* operator new(std::size_t n)
+{
+    ++allocations;
+    if (void* p = std::malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+// Counts the allocations made through it
+template<typename T>
+struct CountingAlloc {
+    using value_type = T;
+    CountingAlloc(int* _count) : count(_count) { }
+    template<typename U>
+    CountingAlloc(const CountingAlloc<U>& a) : count(a.count) { }
+    T* allocate(std::size_t n) { ++*count; return static_cast<T*>(::operator new(n * sizeof(T))); }
+    void deallocate(T* p, std::size_t) { --*count; ::operator delete(p); }
+    int* count;
+};
+
+template<typename T, typename U>
+bool operator==(const CountingAlloc<T>& a, const CountingAlloc<U>& b) { return a.count == b.count; }
+
+template<typename T, typename U>
+bool operator!=(const CountingAlloc<T>& a, const CountingAlloc<U>& b) { return a.count != b.count; }
+
+// Hands objects back to a pool instead of deleting them
+struct Pool {
+    Foo* released = nullptr;
+};
+
 int main()
 {
-    array<>
-    std::shared_ptr<int> si;
-}
\ No newline at end of file
+    // Tests for constructors
+    {
+        sm_ptr::shared_ptr<Foo> sp1;
+        sm_ptr::shared_ptr<Foo> sp2(nullptr);
+        assert(!sp1 && !sp2);
+        assert(sp1.use_count() == 0);
+
+        sm_ptr::shared_ptr<Foo> sp3(new Foo(1));
+        assert(sp3 && sp3->val == 1);
+        assert(sp3.use_count() == 1 && sp3.unique());
+
+        sm_ptr::shared_ptr<Foo> sp4(sp3);
+        assert(sp3.use_count() == 2 && !sp3.unique());
+
+        sm_ptr::shared_ptr<Foo> sp5(std::move(sp4));
+        assert(!sp4 && sp5.use_count() == 2);
+
+        // Bar is destroyed through the control block, not through ~Foo
+        sm_ptr::shared_ptr<Foo> sp6(new Bar);
+        sm_ptr::shared_ptr<Foo> sp7(sm_ptr::shared_ptr<Bar>(new Bar));
+    }
+
+    // Tests for aliasing constructor
+    {
+        struct Pair { int first; int second; };
+        sm_ptr::shared_ptr<Pair> p(new Pair{1, 2});
+        sm_ptr::shared_ptr<int> second(p, &p->second);
+        p.reset();
+        assert(*second == 2 && second.use_count() == 1);
+    }
+
+    // Tests for assignment and reset()
+    {
+        sm_ptr::shared_ptr<Foo> sp1(new Foo(1));
+        sm_ptr::shared_ptr<Foo> sp2(new Foo(2));
+        sp1 = sp2;
+        assert(sp1.get() == sp2.get() && sp1.use_count() == 2);
+        sp1 = sm_ptr::shared_ptr<Bar>(new Bar);
+        assert(sp2.use_count() == 1);
+        sp2.reset(new Foo(3));
+        assert(sp2->val == 3);
+        sp2 = nullptr;
+        assert(sp2 == nullptr);
+    }
+
+    // Tests for make_shared
+    {
+        auto s = sm_ptr::make_shared<std::string>("Hello, world!");
+        std::cout << *s << std::endl;
+        assert(s->size() == 13 && s.unique());
+
+        auto f = sm_ptr::make_shared<Foo>(7);
+        sm_ptr::shared_ptr<const Foo> cf(f);
+        assert(cf->val == 7 && f.use_count() == 2);
+
+        // Trivially destructible objects are freed with their block, even past a weak_ptr
+        sm_ptr::weak_ptr<int> wi;
+        {
+            auto i = sm_ptr::make_shared<int>(42);
+            wi = i;
+            assert(*i == 42 && !wi.expired());
+        }
+        assert(wi.expired());
+
+        // The block is freed if the constructor throws
+        struct Throwing {
+            Throwing() { throw 1; }
+        };
+        bool thrown = false;
+        try
+        {
+            sm_ptr::make_shared<Throwing>();
+        }
+        catch (int)
+        {
+            thrown = true;
+        }
+        assert(thrown);
+
+#ifdef __cpp_aligned_new
+        // Over-aligned objects are aligned in their block, even when trivially destructible
+        struct alignas(64) Line {
+            char bytes[64];
+        };
+        auto line = sm_ptr::make_shared<Line>();
+        auto uline = sm_ptr::make_unique_shareable<Line>();
+        assert(reinterpret_cast<std::uintptr_t>(line.get()) % 64 == 0);
+        assert(reinterpret_cast<std::uintptr_t>(uline.get()) % 64 == 0);
+        sm_ptr::weak_ptr<Line> wline(line);
+        line.reset();
+        assert(wline.expired());
+#endif
+    }
+
+    // Tests for custom deleters
+    {
+        Pool pool;
+        Foo foo(1);
+        {
+            auto to_pool = [&pool](Foo* p) { pool.released = p; };
+            sm_ptr::shared_ptr<Foo> sp(&foo, to_pool);
+            sm_ptr::shared_ptr<Foo> sp2(sp);
+        }
+        assert(pool.released == &foo);
+
+        int deleted = 0;
+        {
+            sm_ptr::shared_ptr<Foo> sp(nullptr, [&deleted](Foo*) { ++deleted; });
+            assert(!sp && sp.use_count() == 1);
+        }
+        assert(deleted == 1);
+
+        sm_ptr::shared_ptr<Foo> sp;
+        sp.reset(new Foo(2), [&deleted](Foo* p) { ++deleted; delete p; });
+        sp.reset();
+        assert(deleted == 2);
+    }
+
+    // The deleter is stored in the single control block allocation
+    {
+        int blocks = 0;
+        Pool pool;
+        Foo foo(1);
+        {
+            sm_ptr::shared_ptr<Foo> sp(&foo, [&pool](Foo* p) { pool.released = p; },
+                                       CountingAlloc<int>(&blocks));
+            assert(blocks == 1);
+            sm_ptr::weak_ptr<Foo> wp(sp);
+            sp.reset();
+            assert(pool.released == &foo && blocks == 1);
+        }
+        assert(blocks == 0);
+    }
+
+    // Tests for conversion from unique_ptr
+    {
+        sm_ptr::unique_ptr<Foo> up(new Bar);
+        sm_ptr::shared_ptr<Foo> sp(std::move(up));
+        assert(!up && sp.unique());
+
+        int deleted = 0;
+        auto deleter = [&deleted](Foo* p) { ++deleted; delete p; };
+        sm_ptr::unique_ptr<Foo, decltype(deleter)> up2(new Foo(3), deleter);
+        sp = std::move(up2);
+        assert(!up2 && sp->val == 3);
+        sp.reset();
+        assert(deleted == 1);
+
+        sm_ptr::unique_ptr<Foo> empty;
+        sm_ptr::shared_ptr<Foo> sp2(std::move(empty));
+        assert(!sp2 && sp2.use_count() == 0);
+    }
+
+    // Tests for make_unique_shareable
+    {
+        // It behaves as a unique_ptr until promoted
+        {
+            auto up = sm_ptr::make_unique_shareable<Foo>(4);
+            assert(up && up->val == 4);
+            auto up2 = std::move(up);
+            assert(!up && up2->val == 4);
+        }
+
+        int before = allocations;
+        auto up = sm_ptr::make_unique_shareable<Bar>();
+        assert(allocations == before + 1);
+
+        // Promotion adopts the reserved control block
+        sm_ptr::unique_shareable_ptr<Foo> base(std::move(up));
+        sm_ptr::shared_ptr<Foo> sp(std::move(base));
+        assert(allocations == before + 1);
+        assert(!base && sp.unique());
+
+        sm_ptr::weak_ptr<Foo> wp(sp);
+        sp.reset();
+        assert(wp.expired());
+
+        // A pointer given to reset() is owned like with default_delete
+        sm_ptr::unique_shareable_ptr<Foo> up3 = sm_ptr::make_unique_shareable<Foo>(1);
+        up3.reset(new Foo(2));
+        assert(up3->val == 2);
+        sm_ptr::shared_ptr<Foo> sp3(std::move(up3));
+        assert(sp3->val == 2 && sp3.unique());
+
+        // After release() the reserved block is not paired with another pointer
+        sm_ptr::unique_shareable_ptr<Foo> up4 = sm_ptr::make_unique_shareable<Foo>(3);
+        Foo* raw = up4.release();
+        up4.reset(new Foo(5));
+        sm_ptr::shared_ptr<Foo> sp4(std::move(up4));
+        assert(sp4->val == 5 && sp4.unique());
+        sp4.reset();
+        assert(raw->val == 3);
+        // Handing the object back lets the deleter release its block
+        up4.reset(raw);
+    }
+
+    // Tests for weak_ptr
+    {
+        sm_ptr::weak_ptr<Foo> wp;
+        assert(wp.expired() && !wp.lock());
+        {
+            auto sp = sm_ptr::make_shared<Foo>(5);
+            wp = sp;
+            assert(!wp.expired() && wp.use_count() == 1);
+
+            auto locked = wp.lock();
+            assert(locked == sp && sp.use_count() == 2);
+
+            sm_ptr::shared_ptr<Foo> from_weak(wp);
+            assert(from_weak->val == 5);
+        }
+        assert(wp.expired() && !wp.lock());
+
+        bool thrown = false;
+        try
+        {
+            sm_ptr::shared_ptr<Foo> sp(wp);
+        }
+        catch (const sm_ptr::bad_weak_ptr& e)
+        {
+            std::cout << e.what() << std::endl;
+            thrown = true;
+        }
+        assert(thrown);
+    }
+
+    // Tests for swap() and comparison
+    {
+        auto sp1 = sm_ptr::make_shared<Foo>(1);
+        auto sp2 = sm_ptr::make_shared<Foo>(2);
+        sm_ptr::swap(sp1, sp2);
+        assert(sp1->val == 2 && sp2->val == 1);
+        assert(sp1 != sp2 && (sp1 < sp2 || sp2 < sp1));
+    }
+
+    // Tests for owner-based ordering and hashing
+    {
+        auto sp = sm_ptr::make_shared<Foo>(1);
+        sm_ptr::shared_ptr<int> alias(sp, &sp->val);
+        sm_ptr::weak_ptr<Foo> wp(sp);
+        auto other = sm_ptr::make_shared<Foo>(2);
+
+        // An aliasing pointer shares its owner, not its address
+        assert(alias.owner_equal(sp) && wp.owner_equal(alias));
+        assert(!alias.owner_before(sp) && !sp.owner_before(wp));
+        assert(alias.owner_hash() == wp.owner_hash());
+        assert(!other.owner_equal(sp) && (other.owner_before(sp) != sp.owner_before(other)));
+        assert(sm_ptr::owner_less()(sp, other) == sp.owner_before(other));
+
+        // The owner outlives the object, so expired weak_ptrs keep their place
+        std::size_t hash = sm_ptr::owner_hash()(wp);
+        sp.reset();
+        alias.reset();
+        assert(wp.expired() && wp.owner_hash() == hash);
+        assert(sm_ptr::weak_ptr<Foo>().owner_equal(sm_ptr::shared_ptr<Foo>()));
+    }
+}
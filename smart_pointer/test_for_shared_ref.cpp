@@ -0,0 +1,116 @@
+#include "shared_ref.h"
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <cassert>
+#include <csignal>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// It is tests for shared_ref
+struct Base {
+    virtual ~Base() { }
+    int id = 1;
+};
+
+struct Derived : Base {
+    std::string name = "derived";
+};
+
+static int handle(sm_ptr::shared_ref<Base> ref)
+{
+    return ref->id;
+}
+
+static sm_ptr::shared_ptr<Base> retain(sm_ptr::shared_ref<Base> ref)
+{
+    return ref.to_shared();
+}
+
+// Return true if f aborts when run in a child process
+template<typename F>
+static bool aborts(F f)
+{
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        f();
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT;
+}
+
+int main()
+{
+    static_assert(sizeof(sm_ptr::shared_ref<int>) == 2 * sizeof(void*),
+                  "shared_ref is two pointers");
+    static_assert(std::is_trivially_copyable<sm_ptr::shared_ref<int>>::value == !SM_PTR_CHECK_BORROWS,
+                  "shared_ref is trivially copied without borrow checks");
+
+    // A temporary owner would be gone before the borrow is used
+    static_assert(std::is_constructible<sm_ptr::shared_ref<Base>, sm_ptr::shared_ptr<Derived>&>::value &&
+                  !std::is_constructible<sm_ptr::shared_ref<Base>, sm_ptr::shared_ptr<Derived>>::value &&
+                  !std::is_constructible<sm_ptr::shared_ref<int>, sm_ptr::shared_ptr<Derived>, int*>::value,
+                  "shared_ref does not borrow from a temporary shared_ptr");
+
+    // Tests for borrowing without refcount traffic
+    {
+        auto sp = sm_ptr::make_shared<Derived>();
+        sm_ptr::shared_ref<Derived> ref(sp);
+        assert(ref.get() == sp.get() && ref->name == "derived" && (*ref).id == 1);
+        assert(sp.use_count() == 1 && ref.use_count() == 1);
+
+        // Conversions to a base, from shared_ptr or from another borrow
+        assert(handle(sp) == 1 && handle(ref) == 1);
+        sm_ptr::shared_ref<Base> base = ref;
+        assert(base == ref && sp.use_count() == 1);
+
+        // Aliasing borrows point into the object
+        sm_ptr::shared_ref<std::string> name(sp, &sp->name);
+        assert(*name == "derived" && name.use_count() == 1);
+    }
+
+    // Tests for to_shared()
+    {
+        sm_ptr::shared_ptr<Base> kept;
+        {
+            auto sp = sm_ptr::make_shared<Derived>();
+            kept = retain(sp);
+            assert(sp.use_count() == 2 && kept.get() == sp.get());
+
+            sm_ptr::shared_ptr<Derived> alias_owner(sp);
+            sm_ptr::shared_ref<int> id(alias_owner, &alias_owner->id);
+            sm_ptr::shared_ptr<int> id_owner = id.to_shared();
+            assert(*id_owner == 1 && sp.use_count() == 4);
+        }
+        assert(kept.unique() && kept->id == 1);
+    }
+
+#if SM_PTR_CHECK_BORROWS
+    // Tests for the borrow checks
+    {
+        assert(aborts([] {
+            sm_ptr::shared_ptr<int> empty;
+            sm_ptr::shared_ref<int> ref(empty);
+        }));
+
+        assert(aborts([] {
+            auto sp = sm_ptr::make_shared<int>(1);
+            sm_ptr::shared_ref<int> ref(sp);
+            sp.reset();
+            std::cout << *ref << std::endl;
+        }));
+
+        // Borrows kept within the lifetime of the owner are fine
+        assert(!aborts([] {
+            auto sp = sm_ptr::make_shared<int>(1);
+            sm_ptr::shared_ref<int> ref(sp);
+            sm_ptr::shared_ref<int> copy(ref);
+            copy = ref;
+        }));
+        std::cout << "shared_ref borrow checks passed" << std::endl;
+    }
+#endif
+}
@@ -0,0 +1,106 @@
+#include "slot_map.h"
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <cassert>
+
+// It is tests for slot_map
+struct Entity {
+    Entity(std::string _name, int _hp) : name(std::move(_name)), hp(_hp) { }
+    std::string name;
+    int hp;
+};
+
+int main()
+{
+    using handle = sm_ptr::slot_map<Entity>::handle;
+
+    // Tests for insertion and lookup
+    {
+        sm_ptr::slot_map<Entity> map;
+        assert(map.empty() && map.get(handle()) == nullptr);
+
+        handle a = map.emplace("a", 1);
+        handle b = map.insert(Entity("b", 2));
+        handle c = map.insert(sm_ptr::make_unique<Entity>("c", 3));
+        assert(map.size() == 3);
+        assert(a != b && b != c);
+        assert(map.get(a)->name == "a" && map.get(b)->hp == 2 && map.get(c)->name == "c");
+        assert(sizeof(handle) == 8);
+
+        // An empty unique_ptr inserts nothing
+        assert(map.insert(sm_ptr::unique_ptr<Entity>()) == handle() && map.size() == 3);
+
+        // Handles survive a round trip through an integer
+        assert(handle::from_value(b.value()) == b);
+
+        // Objects stay dense
+        int total = 0;
+        for (auto& e : map)
+            total += e.hp;
+        assert(total == 6);
+    }
+
+    // Tests for erase() and stale handles
+    {
+        sm_ptr::slot_map<Entity> map;
+        handle a = map.emplace("a", 1);
+        handle b = map.emplace("b", 2);
+        handle c = map.emplace("c", 3);
+
+        assert(map.erase(a));
+        assert(!map.erase(a));
+        assert(!map.contains(a) && map.get(a) == nullptr);
+
+        // The last object moved into the hole and its handle still resolves
+        assert(map.size() == 2 && &*map.begin() == map.get(c));
+        assert(map.get(b)->name == "b" && map.get(c)->name == "c");
+
+        // A reused slot does not revive the old handle
+        handle d = map.emplace("d", 4);
+        assert(map.get(a) == nullptr && map.get(d)->name == "d");
+
+        map.clear();
+        assert(map.empty() && !map.contains(b) && !map.contains(d));
+    }
+
+    // Handles which never came from this map don't resolve to free slots
+    {
+        sm_ptr::slot_map<Entity> map;
+        handle a = map.emplace("a", 1);
+        map.emplace("b", 2);
+        map.erase(a);
+
+        // The free slot of a has moved on to generation 2
+        handle forged = handle::from_value(std::uint64_t(2) << 32 | (a.value() & 0xffffffff));
+        assert(!map.contains(forged) && map.get(forged) == nullptr && !map.erase(forged));
+
+        sm_ptr::slot_map<Entity> other;
+        other.erase(other.emplace("o1", 1));
+        handle o3 = other.emplace("o3", 3);
+        assert(o3.value() == forged.value() && !map.contains(o3));
+        assert(!map.extract(o3) && map.size() == 1 && map.begin()->name == "b");
+    }
+
+    // Tests for extract()
+    {
+        sm_ptr::slot_map<Entity> map;
+        handle a = map.emplace("a", 1);
+        handle b = map.emplace("b", 2);
+
+        sm_ptr::unique_ptr<Entity> e = map.extract(a);
+        assert(e && e->name == "a" && !map.contains(a));
+        assert(!map.extract(a));
+        assert(map.get(b)->hp == 2);
+
+        handle a2 = map.insert(std::move(e));
+        assert(!e && map.get(a2)->name == "a");
+        std::cout << "slot_map holds " << map.size() << " entities\n";
+
+        // Standard types don't make the calls into sm_ptr ambiguous, <memory> is included
+        sm_ptr::slot_map<std::string> names;
+        sm_ptr::unique_ptr<std::string> name = names.extract(names.emplace("c"));
+        assert(*name == "c" && names.empty());
+    }
+}
@@ -0,0 +1,133 @@
+#include "weak_key_map.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cassert>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// It is tests for weak_key_map
+struct Widget {
+    Widget(int _id) : id(_id) { }
+    int id;
+};
+
+// Counts every allocation of the test
+static int allocations = 0;
+
+__attribute__((noinline)) void* operator new(std::size_t n)
+{
+    ++allocations;
+    if (void* p = std::malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+int main()
+{
+    // Tests for insertion and lookup
+    {
+        sm_ptr::weak_key_map<Widget, std::string> map;
+        auto a = sm_ptr::make_shared<Widget>(1);
+        auto b = sm_ptr::make_shared<Widget>(2);
+        assert(map.empty() && map.find(a) == nullptr);
+
+        map.insert(a, "a");
+        map[b] = "b";
+        assert(map.size() == 2);
+        assert(*map.find(a) == "a" && *map.find(b) == "b");
+
+        // insert() keeps the value, insert_or_assign() replaces it
+        assert(map.insert(a, "x") == "a");
+        assert(map.insert_or_assign(a, "y") == "y" && *map.find(a) == "y");
+
+        // Keys are found by owner, so aliasing pointers find the entry of their owner
+        sm_ptr::shared_ptr<Widget> alias(b, b.get());
+        assert(*map.find(alias) == "b");
+
+        // The map does not keep its keys alive
+        assert(a.unique() && b.use_count() == 2);
+
+        assert(map.erase(a) == 1 && map.erase(a) == 0);
+        assert(map.size() == 1 && map.find(a) == nullptr);
+        map.clear();
+        assert(map.empty());
+    }
+
+    // Tests for purge(), with the incremental purge turned off
+    {
+        sm_ptr::weak_key_map<Widget, int> map(0);
+        auto live = sm_ptr::make_shared<Widget>(0);
+        map[live] = 0;
+        for (int i = 1; i <= 10; ++i)
+            map[sm_ptr::make_shared<Widget>(i)] = i;
+        assert(map.size() == 11);
+        map.purge();
+        assert(map.size() == 1 && *map.find(live) == 0);
+    }
+
+    // Tests for the incremental purge
+    {
+        sm_ptr::weak_key_map<Widget, int> map(4);
+        std::vector<sm_ptr::shared_ptr<Widget>> keys;
+        for (int i = 0; i < 100; ++i)
+        {
+            keys.push_back(sm_ptr::make_shared<Widget>(i));
+            map[keys.back()] = i;
+        }
+        assert(map.size() == 100);
+        keys.clear();
+
+        // Each lookup examines at most purge_step entries
+        auto probe = sm_ptr::make_shared<Widget>(-1);
+        map.find(probe);
+        assert(map.size() >= 96);
+
+        // Enough lookups go around the whole map
+        for (int i = 0; i < 30; ++i)
+            map.find(probe);
+        assert(map.empty());
+
+        // Entries inserted while purging are kept as long as their key lives
+        for (int i = 0; i < 50; ++i)
+        {
+            auto key = sm_ptr::make_shared<Widget>(i);
+            if (i % 2 == 0)
+                keys.push_back(key);
+            map[key] = i;
+        }
+        for (int i = 0; i < 50; ++i)
+            map.find(probe);
+        assert(map.size() == 25);
+        for (auto& key : keys)
+            assert(*map.find(key) == key->id);
+    }
+
+    // Hits on an existing key allocate nothing
+    {
+        sm_ptr::weak_key_map<Widget, int> map;
+        auto key = sm_ptr::make_shared<Widget>(1);
+        map[key] = 1;
+        int before = allocations;
+        for (int i = 0; i < 100; ++i)
+        {
+            map.insert(key, 2);
+            ++map[key];
+            ++*map.find(key);
+        }
+        assert(allocations == before && *map.find(key) == 201 && map.size() == 1);
+    }
+
+    std::cout << "weak_key_map tests passed" << std::endl;
+}
@@ -271,7 +271,7 @@ namespace sm_ptr
         {
         private:
             template<typename U>
-            static typename U::Pointer __test(typename U::Pointer *);
+            static typename U::pointer __test(typename U::pointer*);
 
             template<typename U>
             static T* __test(...);
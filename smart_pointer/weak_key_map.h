@@ -0,0 +1,176 @@
+#ifndef WEAK_KEY_MAP_H
+#define WEAK_KEY_MAP_H
+
+#include <cstddef>
+#include <unordered_map>
+#include <utility>
+#include "shared_ptr.h"
+
+namespace sm_ptr
+{
+    /*
+    * Map from shared objects to values which does not keep its keys alive.
+    * Entries are indexed by the control block of their key and keep the key as a weak_ptr,
+    * so an entry stays findable by owner until it is purged even after its key has expired.
+    * The weak_ptr keeps the block allocated, so no other key can take its address meanwhile,
+    * and lookups compare block addresses without touching any reference count.
+    * Instead of sweeping the whole map, every insert and lookup examines the next
+    * purge_step entries after a cursor and drops the expired ones, so the work of
+    * purging is bounded per operation and spread over the map's use.
+    * The cursor restarts from the beginning when an insert rehashes the map.
+    */
+    template<typename K, typename V>
+    class weak_key_map
+    {
+    private:
+        using _Map = std::unordered_map<const _Sp_counted_base*, std::pair<weak_ptr<K>, V>>;
+
+        _Map                        _M_map;
+        typename _Map::iterator     _M_cursor;
+        std::size_t                 _M_purge_step;
+
+        // Drop the expired entries among the next n after the cursor
+        void _M_purge(std::size_t n)
+        {
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                if (_M_cursor == _M_map.end())
+                {
+                    _M_cursor = _M_map.begin();
+                    return;
+                }
+                if (_M_cursor->second.first.expired())
+                    _M_cursor = _M_map.erase(_M_cursor);
+                else
+                    ++_M_cursor;
+            }
+        }
+
+        static const _Sp_counted_base* _S_owner(const shared_ptr<K>& key) noexcept
+        {
+            return _Sp_borrow_access::_S_owner(key);
+        }
+
+        // Return the value of key, inserting one made of args if there is none.
+        // The node and the weak_ptr are only made when key is not found.
+        template<typename ... Args>
+        V& _M_find_or_emplace(const shared_ptr<K>& key, Args&& ... args)
+        {
+            const _Sp_counted_base* owner = _S_owner(key);
+            auto it = _M_map.find(owner);
+            if (it != _M_map.end())
+                return it->second.second;
+
+            std::size_t buckets = _M_map.bucket_count();
+            it = _M_map.emplace(std::piecewise_construct,
+                                std::forward_as_tuple(owner),
+                                std::forward_as_tuple(std::piecewise_construct,
+                                                      std::forward_as_tuple(key),
+                                                      std::forward_as_tuple(std::forward<Args>(args)...))).first;
+            if (_M_map.bucket_count() != buckets)
+                _M_cursor = _M_map.begin();
+            return it->second.second;
+        }
+
+    public:
+        using key_type    = weak_ptr<K>;
+        using mapped_type = V;
+        using size_type   = std::size_t;
+
+        //  Constructors
+
+        explicit weak_key_map(std::size_t purge_step = 2)
+            : _M_map(), _M_cursor(_M_map.end()), _M_purge_step(purge_step) { }
+
+        weak_key_map(const weak_key_map&) = delete;
+        weak_key_map& operator=(const weak_key_map&) = delete;
+
+        // Modifiers
+
+        /// Insert value for key unless key already has one, return the value of key
+        V& insert(const shared_ptr<K>& key, V value)
+        {
+            _M_purge(_M_purge_step);
+            return _M_find_or_emplace(key, std::move(value));
+        }
+
+        /// Insert value for key, replacing any previous value
+        V& insert_or_assign(const shared_ptr<K>& key, V value)
+        {
+            _M_purge(_M_purge_step);
+            auto it = _M_map.find(_S_owner(key));
+            if (it != _M_map.end())
+                return it->second.second = std::move(value);
+            return _M_find_or_emplace(key, std::move(value));
+        }
+
+        /// Return the value of key, inserting a value-initialized one if there is none
+        V& operator[](const shared_ptr<K>& key)
+        {
+            _M_purge(_M_purge_step);
+            return _M_find_or_emplace(key);
+        }
+
+        /// Remove the entry of key, return the number of entries removed
+        size_type erase(const shared_ptr<K>& key)
+        {
+            auto it = _M_map.find(_S_owner(key));
+            if (it == _M_map.end())
+                return 0;
+            if (it == _M_cursor)
+                _M_cursor = _M_map.erase(it);
+            else
+                _M_map.erase(it);
+            return 1;
+        }
+
+        /// Remove every expired entry at once
+        void purge()
+        {
+            for (auto it = _M_map.begin(); it != _M_map.end(); )
+            {
+                if (it->second.first.expired())
+                    it = _M_map.erase(it);
+                else
+                    ++it;
+            }
+            _M_cursor = _M_map.begin();
+        }
+
+        void clear() noexcept
+        {
+            _M_map.clear();
+            _M_cursor = _M_map.end();
+        }
+
+        // Lookup
+
+        /// Return the value of key, or null if there is none
+        V* find(const shared_ptr<K>& key)
+        {
+            _M_purge(_M_purge_step);
+            auto it = _M_map.find(_S_owner(key));
+            return it != _M_map.end() ? &it->second.second : nullptr;
+        }
+
+        // Observers
+
+        /// Return the number of entries, including the expired ones not purged yet
+        size_type size() const noexcept
+        {
+            return _M_map.size();
+        }
+
+        bool empty() const noexcept
+        {
+            return _M_map.empty();
+        }
+
+        size_type purge_step() const noexcept
+        {
+            return _M_purge_step;
+        }
+    };
+}
+
+#endif // WEAK_KEY_MAP_H